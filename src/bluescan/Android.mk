@@ -7,6 +7,11 @@ LOCAL_INIT_RC := bluescan.rc
 LOCAL_SRC_FILES := \
 	bluescan.cpp \
 	callbacks.cpp \
+	beacon_table.cpp \
+	eddystone.cpp \
+	rssi_stats.cpp \
+	scan_log.cpp \
+	sliding_window.cpp \
 
 LOCAL_SHARED_LIBRARIES := \
 	libbinder \
@@ -26,3 +31,39 @@ LOCAL_CPPFLAGS += $(bluetooth_CPPFLAGS)
 
 include $(BUILD_EXECUTABLE)
 
+
+# Result container benchmarks, run on the build host
+# ========================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := beacon_table_bench
+LOCAL_MODULE_TAGS := optional
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../common
+
+LOCAL_SRC_FILES := \
+	bench/beacon_table_bench.cpp \
+	beacon_table.cpp \
+	rssi_stats.cpp \
+	../common/beacon_address.cpp \
+
+LOCAL_CLANG := true
+LOCAL_CFLAGS := -Wall -O2
+
+include $(BUILD_HOST_EXECUTABLE)
+
+
+# Scan log stress check, run on the build host
+# ========================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := scan_log_stress
+LOCAL_MODULE_TAGS := optional
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../common
+
+LOCAL_SRC_FILES := \
+	bench/scan_log_stress.cpp \
+	scan_log.cpp \
+
+LOCAL_CLANG := true
+LOCAL_CFLAGS := -Wall -O2
+LOCAL_LDLIBS := -lpthread
+
+include $(BUILD_HOST_EXECUTABLE)
@@ -0,0 +1,63 @@
+#include "beacon_table.h"
+
+namespace bluescan {
+
+namespace {
+
+// Final mix of MurmurHash3, the low bits of a MAC are not uniform enough
+// on their own (vendors hand out sequential addresses)
+size_t Hash(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return static_cast<size_t>(key);
+}
+
+}  // anonymous namespace
+
+BeaconTable::BeaconTable(size_t capacity)
+    : capacity_(capacity)
+{
+    size_t slots = 2;
+    while (slots < capacity * 2)
+        slots <<= 1;
+
+    slots_.assign(slots, Slot{0, 0, RssiStats()});
+    mask_ = slots - 1;
+}
+
+RssiStats* BeaconTable::FindOrInsert(uint64_t address)
+{
+    // Linear probing, the table is never more than half full so an empty
+    // slot always ends the search
+    for (size_t i = Hash(address) & mask_; ; i = (i + 1) & mask_) {
+        Slot& slot = slots_[i];
+        if (slot.generation != generation_) {
+            if (size_ == capacity_)
+                return NULL;
+            slot.address = address;
+            slot.generation = generation_;
+            slot.stats = RssiStats();
+            size_++;
+            return &slot.stats;
+        }
+        if (slot.address == address)
+            return &slot.stats;
+    }
+}
+
+void BeaconTable::Clear()
+{
+    size_ = 0;
+    if (++generation_ == 0) {
+        // Wrapped around, old generations could look live again
+        for (Slot& slot : slots_)
+            slot.generation = 0;
+        generation_ = 1;
+    }
+}
+
+} // namespace bluescan
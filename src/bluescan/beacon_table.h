@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "rssi_stats.h"
+
+namespace bluescan {
+
+// Fixed-capacity open-addressing hash table from packed MAC addresses to
+// RssiStats. All slots are allocated up front and never reallocated, and
+// Clear() only bumps a generation counter, so the per-advertisement path
+// does no allocation and no string work.
+class BeaconTable {
+public:
+    // Holds up to capacity beacons, the slot array is twice that size
+    // (rounded up to a power of two) to keep probe sequences short.
+    explicit BeaconTable(size_t capacity);
+
+    // Stats of address, inserted empty if not present. Returns NULL when
+    // the table already holds capacity beacons.
+    RssiStats* FindOrInsert(uint64_t address);
+
+    void Clear();
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+
+    // Calls f(address, stats) for every beacon, in no particular order
+    template <typename F>
+    void ForEach(F f) const
+    {
+        for (const Slot& slot : slots_) {
+            if (slot.generation == generation_)
+                f(slot.address, slot.stats);
+        }
+    }
+
+private:
+    struct Slot {
+        uint64_t address;
+        uint32_t generation;
+        RssiStats stats;
+    };
+
+    std::vector<Slot> slots_;
+    size_t mask_;
+    size_t capacity_;
+    size_t size_ = 0;
+    // Slots whose generation differs are empty
+    uint32_t generation_ = 1;
+};
+
+} // namespace bluescan
@@ -0,0 +1,135 @@
+// Per-advertisement cost of the bluescan result containers at 10k
+// advertisements per second, run on the build host.
+//
+// Usage: beacon_table_bench [--beacons <n>] [--filter <substring>]
+//                           [--min-time-ms <ms>] [--out <file>]
+//
+// Each op is one advertisement as seen by OnScanResult. The container is
+// cleared after every 3.5 s worth of advertisements, like a scan window.
+// Prints one JSON document with ns/op and the share of one core that
+// 10k advertisements per second would take.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "beacon_address.h"
+#include "beacon_table.h"
+#include "bench_harness.h"
+#include "rssi_stats.h"
+
+using bluescan::BeaconTable;
+using bluescan::RssiStats;
+using navigator::services::bluescan::FormatAddress;
+using navigator::services::bluescan::ParseAddress;
+
+namespace {
+
+const int kAdvertisementsPerSecond = 10000;
+const int kAdvertisementsPerWindow = kAdvertisementsPerSecond * 35 / 10;
+// Length of the pregenerated advertisement sequence
+const size_t kSequenceLength = 1 << 16;
+
+struct Advertisement {
+    std::string address;
+    int rssi;
+};
+
+struct Bench {
+    std::string name;
+    // Handles one advertisement, end_of_window is set on the last one of a window
+    std::function<void(const Advertisement&, bool end_of_window)> op;
+};
+
+std::vector<Advertisement> MakeSequence(int beacons)
+{
+    std::vector<std::string> addresses;
+    for (int i = 0; i < beacons; i++) {
+        // Sequential addresses from a couple of vendor prefixes, as deployed
+        uint64_t address = (i % 2 ? 0xC47C8D000000ULL : 0xE2C56D000000ULL) + i * 7;
+        addresses.push_back(FormatAddress(address));
+    }
+
+    std::vector<Advertisement> sequence;
+    unsigned int seed = 1;
+    for (size_t i = 0; i < kSequenceLength; i++) {
+        seed = seed * 1103515245 + 12345;
+        int beacon = (seed >> 8) % beacons;
+        int rssi = -50 - static_cast<int>((seed >> 20) % 45);
+        sequence.push_back({addresses[beacon], rssi});
+    }
+    return sequence;
+}
+
+harness::Timing Run(const Bench& bench, const std::vector<Advertisement>& sequence, double min_time_ms)
+{
+    return harness::Measure(min_time_ms, [&](unsigned long iterations) {
+        for (unsigned long i = 0; i < iterations; i++)
+            bench.op(sequence[i % sequence.size()], (i + 1) % kAdvertisementsPerWindow == 0);
+    });
+}
+
+}  // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+    harness::Options options(200);
+    int beacons = 64;
+    options.AddFlag("--beacons", &beacons);
+    if (!options.Parse(argc, argv))
+        return EXIT_FAILURE;
+    if (beacons <= 0) {
+        fprintf(stderr, "--beacons must be positive\n");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Advertisement> sequence = MakeSequence(beacons);
+
+    // Containers live outside the lambdas so their contents survive a window
+    std::map<std::string, int> string_map;
+    std::map<uint64_t, RssiStats> address_map;
+    BeaconTable table(256);
+
+    std::vector<Bench> benches;
+    benches.push_back({"std_map/string_key/last_value", [&](const Advertisement& ad, bool end) {
+        string_map[ad.address] = ad.rssi;
+        if (end)
+            string_map.clear();
+    }});
+    benches.push_back({"std_map/packed_key/stats", [&](const Advertisement& ad, bool end) {
+        uint64_t address;
+        if (ParseAddress(ad.address, &address))
+            address_map[address].Add(ad.rssi);
+        if (end)
+            address_map.clear();
+    }});
+    benches.push_back({"beacon_table/stats", [&](const Advertisement& ad, bool end) {
+        uint64_t address;
+        if (ParseAddress(ad.address, &address)) {
+            if (RssiStats* stats = table.FindOrInsert(address))
+                stats->Add(ad.rssi);
+        }
+        if (end)
+            table.Clear();
+    }});
+
+    harness::Report report;
+    if (!report.Open(options.out_path))
+        return EXIT_FAILURE;
+    report.AddParameter("beacons", beacons);
+
+    for (const Bench& bench : benches) {
+        if (!options.Selected(bench.name))
+            continue;
+
+        harness::Timing timing = Run(bench, sequence, options.min_time_ms);
+        report.AddResult(bench.name, timing);
+        report.AddMetric("core_percent_at_10k_per_s", timing.ns_per_op * kAdvertisementsPerSecond / 1e9 * 100, 3);
+    }
+    report.Finish();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,136 @@
+// Stress check for ScanLog, run on the build host (ideally built with
+// -fsanitize=thread as well).
+//
+// Usage: scan_log_stress [--threads <n>] [--seconds <s>] [--capacity <n>]
+//                        [--window-us <us>]
+//
+// Several producer threads append advertisements as fast as they can
+// while the main thread drains the log every window-us microseconds, the
+// way OnScanResult and the drain timer of the daemon share it. Every entry
+// encodes its producer and sequence number; the check fails if an entry
+// is torn, duplicated or out of order, or if entries go missing without
+// being counted as dropped.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "scan_log.h"
+
+using bluescan::ScanLog;
+using bluescan::ScanLogEntry;
+
+namespace {
+
+ScanLogEntry MakeEntry(uint32_t producer, uint32_t sequence)
+{
+    ScanLogEntry entry;
+    entry.address = static_cast<uint64_t>(producer) << 32 | sequence;
+    entry.timestamp_ms = ~static_cast<int64_t>(entry.address);
+    entry.rssi = static_cast<int8_t>(-(sequence % 100) - 1);
+    entry.frame_length = sequence % (bluescan::kEddystoneMaxFrameSize + 1);
+    memset(entry.frame, static_cast<uint8_t>(sequence), sizeof(entry.frame));
+    return entry;
+}
+
+bool SameEntry(const ScanLogEntry& a, const ScanLogEntry& b)
+{
+    return a.address == b.address && a.timestamp_ms == b.timestamp_ms &&
+           a.rssi == b.rssi && a.frame_length == b.frame_length &&
+           !memcmp(a.frame, b.frame, sizeof(a.frame));
+}
+
+}  // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+    int threads = 4;
+    double seconds = 2;
+    size_t capacity = 8192;
+    int window_us = 1000;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--capacity") && i + 1 < argc) {
+            capacity = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--window-us") && i + 1 < argc) {
+            window_us = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--threads <n>] [--seconds <s>] [--capacity <n>] "
+                            "[--window-us <us>]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (threads <= 0 || capacity == 0) {
+        fprintf(stderr, "--threads and --capacity must be positive\n");
+        return EXIT_FAILURE;
+    }
+
+    ScanLog log(capacity);
+    std::atomic<bool> stop{false};
+    std::vector<std::atomic<uint64_t>> appended(threads);
+    std::vector<std::thread> producers;
+
+    for (int t = 0; t < threads; t++) {
+        appended[t] = 0;
+        producers.emplace_back([&log, &stop, &appended, t]() {
+            uint32_t sequence = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                log.Append(MakeEntry(t, sequence++));
+                appended[t].store(sequence, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    // Next sequence number expected from each producer, at least
+    std::vector<uint32_t> next(threads, 0);
+    uint64_t consumed = 0;
+    uint64_t windows = 0;
+    uint64_t errors = 0;
+
+    auto consume = [&](const ScanLogEntry& entry) {
+        uint32_t producer = static_cast<uint32_t>(entry.address >> 32);
+        uint32_t sequence = static_cast<uint32_t>(entry.address);
+        if (producer >= static_cast<uint32_t>(threads) ||
+            !SameEntry(entry, MakeEntry(producer, sequence)) || sequence < next[producer]) {
+            if (errors++ < 10)
+                fprintf(stderr, "bad entry: producer %u sequence %u\n", producer, sequence);
+            return;
+        }
+        next[producer] = sequence + 1;
+        consumed++;
+    };
+
+    auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+    while (std::chrono::steady_clock::now() < end) {
+        std::this_thread::sleep_for(std::chrono::microseconds(window_us));
+        log.Drain(consume);
+        windows++;
+    }
+
+    stop = true;
+    for (std::thread& producer : producers)
+        producer.join();
+    log.Drain(consume);
+
+    uint64_t total = 0;
+    for (int t = 0; t < threads; t++)
+        total += appended[t].load();
+
+    bool ok = errors == 0 && consumed + log.dropped() == total;
+    printf("{\"threads\": %d, \"windows\": %llu, \"appended\": %llu, \"consumed\": %llu, "
+           "\"dropped\": %llu, \"errors\": %llu, \"ok\": %s}\n",
+           threads, static_cast<unsigned long long>(windows),
+           static_cast<unsigned long long>(total), static_cast<unsigned long long>(consumed),
+           static_cast<unsigned long long>(log.dropped()), static_cast<unsigned long long>(errors),
+           ok ? "true" : "false");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
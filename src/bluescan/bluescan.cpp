@@ -2,6 +2,8 @@
 #include "navigator/services/bluescan/BnBluescanService.h"
 #include "binder_constants.h"
 
+#include <map>
+#include <memory>
 #include <string>
 #include <sysexits.h>
 
@@ -9,6 +11,7 @@
 #include <base/command_line.h>
 #include <base/macros.h>
 #include <base/memory/weak_ptr.h>
+#include <base/time/time.h>
 #include <binderwrapper/binder_wrapper.h>
 #include <brillo/binder_watcher.h>
 #include <brillo/daemons/daemon.h>
@@ -17,28 +20,95 @@
 #include <bluetooth/scan_filter.h>
 #include <bluetooth/scan_settings.h>
 #include <bluetooth/uuid.h>
+#include <utils/String8.h>
 
 using ipc::binder::IBluetooth;
 using ipc::binder::IBluetoothLowEnergy;
 using android::sp;
 using namespace bluescan;
 
-sp<IBluetooth> bt_iface;
-sp<IBluetoothLowEnergy> ble_iface;
+namespace {
+// 16-bit service UUID Eddystone frames are advertised under
+const char kEddystoneServiceUuid[] = "FEAA";
+
+// How often advertisements are moved from the scan log into the results
+// while a scan runs
+const int kDrainIntervalMs = 100;
+}  // anonymous namespace
 
 class BluescanService : public navigator::services::bluescan::BnBluescanService {
 public:
-    void InitializeService();
-    android::binder::Status DoScan(int milliseconds);
-    android::binder::Status RegisterCallback(const sp<navigator::services::bluescan::IBluescanCallback>& callback);
+    void InitializeService(const sp<IBluetooth>& bt_iface);
+    android::binder::Status DoScan(int session, int milliseconds);
+    android::binder::Status DoStreamingScan(int session, int milliseconds, int batchIntervalMs, int batchSize);
+    android::binder::Status StartContinuousScan(int session, int windowMs, int snapshotPeriodMs);
+    android::binder::Status StopContinuousScan(int session);
+    android::binder::Status RequestSnapshot(int session);
+    android::binder::Status ConfigureScan(int scanMode, int reportDelayMs, bool eddystoneOnly,
+                                          const std::vector<android::String16>& allowedAddresses,
+                                          const std::vector<int8_t>& allowedNamespaces);
+    android::binder::Status RegisterCallback(const sp<navigator::services::bluescan::IBluescanCallback>& callback,
+                                             int32_t* session);
+    android::binder::Status UnregisterCallback(int session);
         
 private:
-	void StopScan();
+    // One client of the service, see IBluescanService
+    struct Session {
+        sp<navigator::services::bluescan::IBluescanCallback> callback;
+        sp<android::IBinder> binder;
+        ScanSession scan;
+
+        // A DoScan window is running
+        bool window_scan = false;
+
+        // Streaming state. The generation discards flush timers left over
+        // from a previous streaming scan.
+        bool streaming = false;
+        int stream_generation = 0;
+        int stream_interval_ms = 0;
+
+        // Continuous mode state, the generation works as for streaming
+        bool continuous = false;
+        int snapshot_generation = 0;
+        int snapshot_period_ms = 0;
+    };
+
+    Session* FindSession(int session);
+    bool HasSessions(const sp<android::IBinder>& binder) const;
+    // client_died: the binder is gone, and so is its death notification
+    void CloseSession(int session, bool client_died);
+    void OnClientDied(sp<android::IBinder> binder);
+
+    // The radio scans while at least one session runs a window or a
+    // continuous scan
+    void AcquireRadio();
+    void ReleaseRadio();
+
+    void OnWindowEnd(int session);
     void RegisterBLEClient();
+    void FlushStreamBatch(int session);
+    void OnStreamTimer(int session, int generation);
+    void OnSnapshotTimer(int session, int generation);
+    void ScheduleDrain();
+    void OnDrainTimer();
     
-    sp<navigator::services::bluescan::IBluescanCallback> cbo_;
 	base::WeakPtrFactory<BluescanService> weak_ptr_factory_{this};
-    std::vector<android::String16> scanResults_;
+    std::vector<BeaconSample> scanResults_;
+    std::vector<BeaconSample> streamBatch_;
+
+    // Sessions by handle, handles are never reused
+    std::map<int, std::unique_ptr<Session>> sessions_;
+    int next_session_ = 1;
+    int radio_users_ = 0;
+
+    // Applied by every StartScan, see ConfigureScan
+    bluetooth::ScanSettings scan_settings_;
+    std::vector<bluetooth::ScanFilter> scan_filters_;
+
+    bool drain_scheduled_ = false;
+
+    sp<IBluetooth> bt_iface_;
+    sp<IBluetoothLowEnergy> ble_iface_;
     
     sp<BluescanBluetoothCallback> callbackBT_;
     sp<BluescanBluetoothLowEnergyCallback> callbackBLE_;
@@ -46,12 +116,13 @@ private:
 
 class Daemon final : public brillo::Daemon {
 public:
-    Daemon() = default;
+    explicit Daemon(const sp<IBluetooth>& bt_iface) : bt_iface_(bt_iface) {}
 
 protected:
     int OnInit() override;
 
 private:
+    sp<IBluetooth> bt_iface_;
     sp<BluescanService> bluescan_service_;
     brillo::BinderWatcher binder_watcher_;
 
@@ -60,30 +131,30 @@ private:
     DISALLOW_COPY_AND_ASSIGN(Daemon);
 };
 
-void BluescanService::InitializeService()
+void BluescanService::InitializeService(const sp<IBluetooth>& bt_iface)
 {
+    bt_iface_ = bt_iface;
     
     // Register Adapter state-change callback
     callbackBT_ = new BluescanBluetoothCallback();
     callbackBLE_ = new BluescanBluetoothLowEnergyCallback();
-    bt_iface->RegisterCallback(callbackBT_);
+    bt_iface_->RegisterCallback(callbackBT_);
     
-    bt_iface->Enable();
+    bt_iface_->Enable();
     
     RegisterBLEClient();
 }
 
 void BluescanService::RegisterBLEClient()
 {
-    if (state == bluetooth::ADAPTER_STATE_ON)
+    if (callbackBT_->state() == bluetooth::ADAPTER_STATE_ON)
     {
         //Create and register to bluetooth ble interface
-        ble_iface = bt_iface->GetLowEnergyInterface();
-        if (!ble_iface.get()) {
+        ble_iface_ = bt_iface_->GetLowEnergyInterface();
+        if (!ble_iface_.get()) {
             LOG(ERROR) << "Failed to obtain handle to Bluetooth Low Energy interface";
-            ble_registered = false;
         }else{
-            ble_iface->RegisterClient(callbackBLE_);
+            ble_iface_->RegisterClient(callbackBLE_);
         }
     }else
     {
@@ -95,19 +166,59 @@ void BluescanService::RegisterBLEClient()
     }
 }
 
-android::binder::Status BluescanService::DoScan(int milliseconds)
+BluescanService::Session* BluescanService::FindSession(int session)
 {
-    if(ble_registered)
-    {
+    auto it = sessions_.find(session);
+    return it == sessions_.end() ? nullptr : it->second.get();
+}
+
+bool BluescanService::HasSessions(const sp<android::IBinder>& binder) const
+{
+    for (const auto& entry : sessions_) {
+        if (entry.second->binder == binder)
+            return true;
+    }
+    return false;
+}
+
+void BluescanService::AcquireRadio()
+{
+    if (radio_users_++ == 0) {
         LOG(INFO) << "Starting scan...";
-        bluetooth::ScanSettings settings;
-        std::vector<bluetooth::ScanFilter> filters;
-        ble_iface->StartScan(ble_client_id, settings, filters);
+        ble_iface_->StartScan(callbackBLE_->client_id(), scan_settings_, scan_filters_);
+        ScheduleDrain();
+    }
+}
+
+void BluescanService::ReleaseRadio()
+{
+    if (--radio_users_ == 0) {
+        LOG(INFO) << "Stopping scan...";
+        ble_iface_->StopScan(callbackBLE_->client_id());
+    }
+}
+
+android::binder::Status BluescanService::DoScan(int session, int milliseconds)
+{
+    Session* s = FindSession(session);
+    if (!s)
+        return android::binder::Status::fromExceptionCode(android::binder::Status::EX_ILLEGAL_ARGUMENT);
+
+    if (s->window_scan || s->continuous) {
+        LOG(ERROR) << "Session " << session << " already scanning!";
+        return android::binder::Status::fromExceptionCode(android::binder::Status::EX_ILLEGAL_STATE);
+    }
+
+    if(callbackBLE_->registered())
+    {
+        s->window_scan = true;
+        callbackBLE_->Attach(&s->scan);
+        AcquireRadio();
 		
-		//Schedule stop scan
+		//Schedule end of the window
         brillo::MessageLoop::current()->PostDelayedTask(
-            base::Bind(&BluescanService::StopScan,
-                       weak_ptr_factory_.GetWeakPtr()),
+            base::Bind(&BluescanService::OnWindowEnd,
+                       weak_ptr_factory_.GetWeakPtr(), session),
             base::TimeDelta::FromMilliseconds(milliseconds));
     }else{
         LOG(ERROR) << "BLE not registered!";
@@ -117,27 +228,300 @@ android::binder::Status BluescanService::DoScan(int milliseconds)
     return android::binder::Status::ok();
 }
 
-void BluescanService::StopScan()
+android::binder::Status BluescanService::DoStreamingScan(int session, int milliseconds, int batchIntervalMs, int batchSize)
 {
-	if(ble_registered)
-    {
-        LOG(INFO) << "Stopping scan...";
-        ble_iface->StopScan(ble_client_id);
-        
-        scanResults_.clear();
-        callbackBLE_->CopyScanResults(scanResults_);
-        cbo_->OnFinishScanCallback(scanResults_);
-    }else{
-        LOG(ERROR) << "BLE not registered!";
+    if (batchIntervalMs <= 0 || batchSize <= 0)
+        return android::binder::Status::fromExceptionCode(android::binder::Status::EX_ILLEGAL_ARGUMENT);
+
+    android::binder::Status status = DoScan(session, milliseconds);
+    if (!status.isOk())
+        return status;
+
+    Session* s = FindSession(session);
+    s->streaming = true;
+    s->stream_interval_ms = batchIntervalMs;
+    callbackBLE_->StartStreaming(&s->scan, batchSize,
+        base::Bind(&BluescanService::FlushStreamBatch, weak_ptr_factory_.GetWeakPtr(), session));
+
+    brillo::MessageLoop::current()->PostDelayedTask(
+        base::Bind(&BluescanService::OnStreamTimer,
+                   weak_ptr_factory_.GetWeakPtr(), session, ++s->stream_generation),
+        base::TimeDelta::FromMilliseconds(s->stream_interval_ms));
+
+    return android::binder::Status::ok();
+}
+
+void BluescanService::FlushStreamBatch(int session)
+{
+    Session* s = FindSession(session);
+    if (!s)
+        return;
+
+    streamBatch_.clear();
+    callbackBLE_->TakeStreamBatch(&s->scan, streamBatch_);
+    if (!streamBatch_.empty())
+        s->callback->OnScanBatch(streamBatch_);
+}
+
+void BluescanService::OnStreamTimer(int session, int generation)
+{
+    Session* s = FindSession(session);
+    if (!s || !s->streaming || generation != s->stream_generation)
+        return;
+
+    FlushStreamBatch(session);
+
+    brillo::MessageLoop::current()->PostDelayedTask(
+        base::Bind(&BluescanService::OnStreamTimer,
+                   weak_ptr_factory_.GetWeakPtr(), session, generation),
+        base::TimeDelta::FromMilliseconds(s->stream_interval_ms));
+}
+
+void BluescanService::OnWindowEnd(int session)
+{
+    Session* s = FindSession(session);
+    if (!s || !s->window_scan)
+        return;
+
+    s->window_scan = false;
+    if (s->streaming) {
+        // Deliver the tail of the stream before the window summary.
+        FlushStreamBatch(session);
+        callbackBLE_->StopStreaming(&s->scan);
+        s->streaming = false;
+    }
+
+    scanResults_.clear();
+    callbackBLE_->CopyScanResults(&s->scan, scanResults_);
+    callbackBLE_->Detach(&s->scan);
+    ReleaseRadio();
+    s->callback->OnFinishScanCallback(scanResults_);
+}
+
+void BluescanService::ScheduleDrain()
+{
+    if (drain_scheduled_)
+        return;
+
+    drain_scheduled_ = true;
+    brillo::MessageLoop::current()->PostDelayedTask(
+        base::Bind(&BluescanService::OnDrainTimer,
+                   weak_ptr_factory_.GetWeakPtr()),
+        base::TimeDelta::FromMilliseconds(kDrainIntervalMs));
+}
+
+void BluescanService::OnDrainTimer()
+{
+    drain_scheduled_ = false;
+    if (!radio_users_)
+        return;
+
+    callbackBLE_->Drain();
+    ScheduleDrain();
+}
+
+android::binder::Status BluescanService::StartContinuousScan(int session, int windowMs, int snapshotPeriodMs)
+{
+    Session* s = FindSession(session);
+    if (!s || windowMs <= 0 || snapshotPeriodMs < 0)
+        return android::binder::Status::fromExceptionCode(android::binder::Status::EX_ILLEGAL_ARGUMENT);
+
+    if (!callbackBLE_->registered() || s->window_scan) {
+        LOG(ERROR) << "Cannot start continuous scan now";
+        return android::binder::Status::fromExceptionCode(android::binder::Status::EX_ILLEGAL_STATE);
+    }
+
+    // Reconfiguring a running continuous scan keeps the session attached
+    if (!s->continuous) {
+        LOG(INFO) << "Starting continuous scan for session " << session << "...";
+        callbackBLE_->Attach(&s->scan);
+        AcquireRadio();
+    }
+
+    s->continuous = true;
+    s->snapshot_period_ms = snapshotPeriodMs;
+    callbackBLE_->StartContinuous(&s->scan, windowMs);
+
+    ++s->snapshot_generation;
+    if (s->snapshot_period_ms > 0) {
+        brillo::MessageLoop::current()->PostDelayedTask(
+            base::Bind(&BluescanService::OnSnapshotTimer,
+                       weak_ptr_factory_.GetWeakPtr(), session, s->snapshot_generation),
+            base::TimeDelta::FromMilliseconds(s->snapshot_period_ms));
+    }
+
+    return android::binder::Status::ok();
+}
+
+android::binder::Status BluescanService::StopContinuousScan(int session)
+{
+    Session* s = FindSession(session);
+    if (!s)
+        return android::binder::Status::fromExceptionCode(android::binder::Status::EX_ILLEGAL_ARGUMENT);
+
+    if (!s->continuous)
+        return android::binder::Status::ok();
+
+    LOG(INFO) << "Stopping continuous scan for session " << session << "...";
+    callbackBLE_->StopContinuous(&s->scan);
+    callbackBLE_->Detach(&s->scan);
+    ReleaseRadio();
+    s->continuous = false;
+    ++s->snapshot_generation;
+
+    return android::binder::Status::ok();
+}
+
+android::binder::Status BluescanService::RequestSnapshot(int session)
+{
+    Session* s = FindSession(session);
+    if (!s)
+        return android::binder::Status::fromExceptionCode(android::binder::Status::EX_ILLEGAL_ARGUMENT);
+
+    if (!s->continuous)
+        return android::binder::Status::fromExceptionCode(android::binder::Status::EX_ILLEGAL_STATE);
+
+    scanResults_.clear();
+    callbackBLE_->CopySnapshot(&s->scan, scanResults_);
+    s->callback->OnFinishScanCallback(scanResults_);
+
+    return android::binder::Status::ok();
+}
+
+void BluescanService::OnSnapshotTimer(int session, int generation)
+{
+    Session* s = FindSession(session);
+    if (!s || !s->continuous || generation != s->snapshot_generation)
+        return;
+
+    RequestSnapshot(session);
+
+    brillo::MessageLoop::current()->PostDelayedTask(
+        base::Bind(&BluescanService::OnSnapshotTimer,
+                   weak_ptr_factory_.GetWeakPtr(), session, generation),
+        base::TimeDelta::FromMilliseconds(s->snapshot_period_ms));
+}
+
+android::binder::Status BluescanService::ConfigureScan(int scanMode, int reportDelayMs, bool eddystoneOnly,
+                                                       const std::vector<android::String16>& allowedAddresses,
+                                                       const std::vector<int8_t>& allowedNamespaces)
+{
+    using navigator::services::bluescan::IBluescanService;
+
+    if (scanMode < IBluescanService::SCAN_MODE_LOW_POWER ||
+        scanMode > IBluescanService::SCAN_MODE_LOW_LATENCY || reportDelayMs < 0 ||
+        allowedNamespaces.size() % kEddystoneNamespaceSize)
+        return android::binder::Status::fromExceptionCode(android::binder::Status::EX_ILLEGAL_ARGUMENT);
+
+    bluetooth::ScanFilter base_filter;
+    if (eddystoneOnly) {
+        bool valid = false;
+        bluetooth::UUID eddystone = bluetooth::UUID::FromString(kEddystoneServiceUuid, &valid);
+        if (!valid)
+            return android::binder::Status::fromExceptionCode(android::binder::Status::EX_ILLEGAL_STATE);
+        base_filter.SetServiceUuid(eddystone);
+    }
+
+    // Filters are OR'ed by the controller, one per allowed address
+    std::vector<bluetooth::ScanFilter> filters;
+    for (const android::String16& address : allowedAddresses) {
+        bluetooth::ScanFilter filter = base_filter;
+        if (!filter.SetDeviceAddress(android::String8(address).string())) {
+            LOG(ERROR) << "Invalid address in scan allow-list: " << android::String8(address).string();
+            return android::binder::Status::fromExceptionCode(android::binder::Status::EX_ILLEGAL_ARGUMENT);
+        }
+        filters.push_back(filter);
+    }
+    if (filters.empty() && eddystoneOnly)
+        filters.push_back(base_filter);
+
+    scan_settings_.set_mode(static_cast<bluetooth::ScanSettings::Mode>(scanMode));
+    scan_settings_.set_report_delay(base::TimeDelta::FromMilliseconds(reportDelayMs));
+    scan_filters_.swap(filters);
+    callbackBLE_->SetAllowedNamespaces(allowedNamespaces);
+
+    LOG(INFO) << "Scan configured: mode " << scanMode << ", report delay " << reportDelayMs
+              << " ms, " << scan_filters_.size() << " filters, "
+              << allowedNamespaces.size() / kEddystoneNamespaceSize << " namespaces";
+
+    if (radio_users_) {
+        ble_iface_->StopScan(callbackBLE_->client_id());
+        ble_iface_->StartScan(callbackBLE_->client_id(), scan_settings_, scan_filters_);
+    }
+
+    return android::binder::Status::ok();
+}
+
+android::binder::Status BluescanService::RegisterCallback(const sp<navigator::services::bluescan::IBluescanCallback>& callback,
+                                                          int32_t* session)
+{
+    if (!callback.get())
+        return android::binder::Status::fromExceptionCode(android::binder::Status::EX_ILLEGAL_ARGUMENT);
+
+    // One death notification per client, shared by all its sessions
+    sp<android::IBinder> binder = android::IInterface::asBinder(callback);
+    if (!HasSessions(binder)) {
+        android::BinderWrapper::Get()->RegisterForDeathNotifications(
+            binder,
+            base::Bind(&BluescanService::OnClientDied,
+                       weak_ptr_factory_.GetWeakPtr(), binder));
     }
+
+    std::unique_ptr<Session> s(new Session);
+    s->callback = callback;
+    s->binder = binder;
+    *session = next_session_++;
+    sessions_[*session] = std::move(s);
+
+    LOG(INFO) << "Session " << *session << " opened";
+    return android::binder::Status::ok();
 }
 
-android::binder::Status BluescanService::RegisterCallback(const sp<navigator::services::bluescan::IBluescanCallback>& callback)
+android::binder::Status BluescanService::UnregisterCallback(int session)
 {
-    cbo_ = callback;
+    if (!FindSession(session))
+        return android::binder::Status::fromExceptionCode(android::binder::Status::EX_ILLEGAL_ARGUMENT);
+
+    CloseSession(session, false);
     return android::binder::Status::ok();
 }
 
+void BluescanService::CloseSession(int session, bool client_died)
+{
+    auto it = sessions_.find(session);
+    Session* s = it->second.get();
+
+    if (s->streaming)
+        callbackBLE_->StopStreaming(&s->scan);
+    if (s->continuous)
+        callbackBLE_->StopContinuous(&s->scan);
+    if (s->window_scan || s->continuous) {
+        callbackBLE_->Detach(&s->scan);
+        ReleaseRadio();
+    }
+
+    sp<android::IBinder> binder = s->binder;
+    sessions_.erase(it);
+    LOG(INFO) << "Session " << session << " closed";
+
+    // Unlinking a dead binder fails with DEAD_OBJECT
+    if (!client_died && !HasSessions(binder))
+        android::BinderWrapper::Get()->UnregisterForDeathNotifications(binder);
+}
+
+void BluescanService::OnClientDied(sp<android::IBinder> binder)
+{
+    LOG(INFO) << "Client died, closing its sessions";
+
+    std::vector<int> dead;
+    for (const auto& entry : sessions_) {
+        if (entry.second->binder == binder)
+            dead.push_back(entry.first);
+    }
+    for (int session : dead)
+        CloseSession(session, true);
+}
+
 int Daemon::OnInit() {
     int return_code = brillo::Daemon::OnInit();
     if (return_code != EX_OK)
@@ -148,7 +532,7 @@ int Daemon::OnInit() {
         return EX_OSERR;
         
     bluescan_service_ = new BluescanService();
-    bluescan_service_->InitializeService();
+    bluescan_service_->InitializeService(bt_iface_);
     
     android::BinderWrapper::Get()->RegisterService(
         services::kBinderBluescanServiceName,
@@ -164,13 +548,13 @@ int main(int argc, char* argv[]) {
     base::CommandLine::Init(argc, argv);
     brillo::InitLog(brillo::kLogToSyslog | brillo::kLogHeader);
     
-    bt_iface = IBluetooth::getClientInterface();
+    sp<IBluetooth> bt_iface = IBluetooth::getClientInterface();
     if (!bt_iface.get()) {
         LOG(ERROR) << "Failed to obtain handle on IBluetooth";
         return EXIT_FAILURE;
     }
     
     LOG(INFO) << "Starting bluescan daemon...";
-    Daemon daemon;
+    Daemon daemon(bt_iface);
     return daemon.Run();
 }
@@ -2,11 +2,41 @@
 #include "navigator_constants.h"
 #include <base/logging.h>
 
-using ipc::binder::IBluetooth;
+#include <string.h>
 
-volatile bluetooth::AdapterState state = bluetooth::ADAPTER_STATE_DISCONNECTED;
-volatile bool ble_registered = false;
-volatile int ble_client_id = 0;
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Number of time buckets a continuous-mode window is split into
+const int kWindowBuckets = 10;
+
+// Frame information of beacons not heard for this long is forgotten
+const int64_t kInfoExpiryMs = 60000;
+
+// Advertisements buffered between two drains, per half of the scan log
+const size_t kScanLogCapacity = 8192;
+
+int64_t MonotonicMs()
+{
+    return (base::TimeTicks::Now() - base::TimeTicks()).InMilliseconds();
+}
+
+// The statistic the navigator reports as "rssi", so the strongest beacons
+// are picked on the value that is sent
+int ReportedRssi(const bluescan::RssiStats& stats)
+{
+    switch (navigator::ReportedRssiStatistic) {
+    case navigator::RssiStatistic::kMean:   return std::lround(stats.mean());
+    case navigator::RssiStatistic::kMedian: return stats.median();
+    case navigator::RssiStatistic::kMax:    return stats.max();
+    case navigator::RssiStatistic::kEwma:   return std::lround(stats.ewma());
+    }
+    return stats.median();
+}
+}  // anonymous namespace
+
+using navigator::services::bluescan::ParseAddress;
 
 namespace bluescan {
 
@@ -15,7 +45,12 @@ void BluescanBluetoothCallback::OnBluetoothStateChange(
     bluetooth::AdapterState /* prev_state */,
     bluetooth::AdapterState new_state) {
     
-    state = new_state;
+    state_ = new_state;
+}
+
+BluescanBluetoothLowEnergyCallback::BluescanBluetoothLowEnergyCallback()
+    : log_(kScanLogCapacity)
+{
 }
    
 void BluescanBluetoothLowEnergyCallback::OnScanResult
@@ -24,38 +59,328 @@ void BluescanBluetoothLowEnergyCallback::OnScanResult
     //LOG(INFO) << "Scan result: " << "[" << scan_result.device_address() << "] "
      //           << "- RSSI: " << scan_result.rssi();
     
-    
-    scanResults_[scan_result.device_address()] = scan_result.rssi();
+    // Binder thread: only hand the advertisement over, everything else
+    // happens in Drain on the message loop
+    ScanLogEntry entry;
+    if (!ParseAddress(scan_result.device_address(), &entry.address))
+        return;
+    entry.timestamp_ms = MonotonicMs();
+    entry.rssi = static_cast<int8_t>(scan_result.rssi());
+
+    const std::vector<uint8_t>& record = scan_result.scan_record();
+    const uint8_t* frame;
+    size_t frame_length;
+    if (!record.empty() && FindEddystoneFrame(record.data(), record.size(), &frame, &frame_length)) {
+        entry.frame_length = std::min(frame_length, kEddystoneMaxFrameSize);
+        memcpy(entry.frame, frame, entry.frame_length);
+    } else {
+        entry.frame_length = 0;
+    }
+
+    log_.Append(entry);
 }
 
-void BluescanBluetoothLowEnergyCallback::CopyScanResults(std::vector<android::String16>& copy)
+void BluescanBluetoothLowEnergyCallback::Drain()
 {
-    std::map<std::string,int>::iterator myMapIterator;
-    
-    int index = 0;
-    for(myMapIterator = scanResults_.begin(); 
-        myMapIterator != scanResults_.end();
-        myMapIterator++)
-    {
-        if(index < navigator::MaxScanBeacons)
-        {
-            std::string beacon_str = myMapIterator->first + navigator::BluescanStringDelimeter + std::to_string(myMapIterator->second);
-            copy.push_back(android::String16(beacon_str.c_str()));
-            index++;
+    DrainLog();
+
+    // The flushes take their batch with TakeStreamBatch, which only folds
+    // the log and never gets back here. Collect first, a flush may also
+    // detach sessions.
+    std::vector<base::Closure> full;
+    for (ScanSession* session : sessions_) {
+        if (session->streaming && session->stream.size() >= session->stream_batch_size &&
+            !session->on_batch_full.is_null())
+            full.push_back(session->on_batch_full);
+    }
+    for (const base::Closure& on_batch_full : full)
+        on_batch_full.Run();
+}
+
+void BluescanBluetoothLowEnergyCallback::DrainLog()
+{
+    log_.Drain([this](const ScanLogEntry& entry) { Consume(entry); });
+
+    uint64_t dropped = log_.dropped();
+    if (dropped != reported_dropped_) {
+        LOG(WARNING) << "Scan log full, " << dropped - reported_dropped_ << " advertisements dropped";
+        reported_dropped_ = dropped;
+    }
+}
+
+void BluescanBluetoothLowEnergyCallback::Consume(const ScanLogEntry& entry)
+{
+    uint64_t key;
+    if (!IdentifyBeacon(entry, &key))
+        return;
+
+    BeaconSample sample;
+    bool have_sample = false;
+    for (ScanSession* session : sessions_) {
+        if (session->window)
+            session->window->Add(key, entry.rssi, entry.timestamp_ms);
+        else if (RssiStats* stats = session->table.FindOrInsert(key))
+            stats->Add(entry.rssi);
+
+        if (!session->streaming)
+            continue;
+        if (!have_sample) {
+            sample.address = key;
+            sample.timestamp_ms = entry.timestamp_ms;
+            sample.count = 1;
+            sample.rssi = sample.median = sample.min = sample.max = entry.rssi;
+            sample.mean = sample.ewma = entry.rssi;
+            FillIdentity(key, &sample);
+            sample.last_address = entry.address;
+            have_sample = true;
         }
+        session->stream.push_back(sample);
     }
-    
-    scanResults_.clear();
-    
+}
+
+bool BluescanBluetoothLowEnergyCallback::IdentifyBeacon(const ScanLogEntry& entry, uint64_t* key)
+{
+    uint64_t address = entry.address;
+    int64_t now_ms = entry.timestamp_ms;
+    EddystoneFrame frame;
+    bool eddystone = entry.frame_length && ParseEddystoneFrame(entry.frame, entry.frame_length, &frame);
+
+    if (eddystone && frame.type == EddystoneFrameType::kUid) {
+        if (!allowed_namespaces_.empty() &&
+            std::none_of(allowed_namespaces_.begin(), allowed_namespaces_.end(),
+                         [&frame](const std::array<uint8_t, kEddystoneNamespaceSize>& id) {
+                             return !memcmp(id.data(), frame.namespace_id, id.size());
+                         }))
+            return false;
+        *key = UidKey(frame.namespace_id, frame.instance_id);
+
+        BeaconInfo& info = info_[*key];
+        info.has_uid = true;
+        memcpy(info.uid, frame.namespace_id, kEddystoneNamespaceSize);
+        memcpy(info.uid + kEddystoneNamespaceSize, frame.instance_id, kEddystoneInstanceSize);
+        info.address = address;
+        info.has_tx_power = true;
+        info.tx_power = frame.tx_power;
+        info.last_seen_ms = now_ms;
+        address_keys_[address] = {*key, now_ms};
+        return true;
+    }
+
+    // EID, URL, TLM and anything else belong to the beacon that last sent
+    // a UID frame from this address, if any. EIDs rotate by design, along
+    // with the address, so an EID-only beacon is keyed by its address and
+    // cannot be followed across a rotation.
+    auto it = address_keys_.find(address);
+    if (it != address_keys_.end()) {
+        *key = it->second.key;
+        it->second.last_seen_ms = now_ms;
+    } else if (!allowed_namespaces_.empty()) {
+        return false;
+    } else {
+        *key = address;
+    }
+
+    if (eddystone && frame.type == EddystoneFrameType::kTlm) {
+        BeaconInfo& info = info_[*key];
+        info.has_telemetry = true;
+        info.battery_mv = frame.battery_mv;
+        info.temperature = frame.temperature;
+        info.last_seen_ms = now_ms;
+    } else if (eddystone && (frame.type == EddystoneFrameType::kUrl ||
+                             frame.type == EddystoneFrameType::kEid)) {
+        BeaconInfo& info = info_[*key];
+        info.has_tx_power = true;
+        info.tx_power = frame.tx_power;
+        info.last_seen_ms = now_ms;
+    }
+    return true;
+}
+
+void BluescanBluetoothLowEnergyCallback::FillIdentity(uint64_t key, BeaconSample* sample) const
+{
+    sample->last_address = key;
+    auto it = info_.find(key);
+    if (it == info_.end())
+        return;
+
+    const BeaconInfo& info = it->second;
+    if (!IsAddressKey(key))
+        sample->last_address = info.address;
+    sample->has_uid = info.has_uid;
+    if (info.has_uid)
+        memcpy(sample->uid, info.uid, sizeof(sample->uid));
+    sample->has_tx_power = info.has_tx_power;
+    if (info.has_tx_power) {
+        sample->tx_power = info.tx_power;
+        sample->distance = EstimateDistance(info.tx_power, sample->rssi);
+    }
+    sample->has_telemetry = info.has_telemetry;
+    sample->battery_mv = info.battery_mv;
+    sample->temperature = info.temperature;
+}
+
+void BluescanBluetoothLowEnergyCallback::ExpireInfo(int64_t now_ms)
+{
+    for (auto it = info_.begin(); it != info_.end();) {
+        if (now_ms - it->second.last_seen_ms > kInfoExpiryMs)
+            it = info_.erase(it);
+        else
+            ++it;
+    }
+    for (auto it = address_keys_.begin(); it != address_keys_.end();) {
+        if (now_ms - it->second.last_seen_ms > kInfoExpiryMs)
+            it = address_keys_.erase(it);
+        else
+            ++it;
+    }
+}
+
+bool BluescanBluetoothLowEnergyCallback::SetAllowedNamespaces(const std::vector<int8_t>& namespaces)
+{
+    if (namespaces.size() % kEddystoneNamespaceSize)
+        return false;
+
+    allowed_namespaces_.clear();
+    for (size_t i = 0; i < namespaces.size(); i += kEddystoneNamespaceSize) {
+        std::array<uint8_t, kEddystoneNamespaceSize> id;
+        memcpy(id.data(), &namespaces[i], kEddystoneNamespaceSize);
+        allowed_namespaces_.push_back(id);
+    }
+    return true;
+}
+
+void BluescanBluetoothLowEnergyCallback::Attach(ScanSession* session)
+{
+    // Advertisements already logged belong to the sessions running so far
+    DrainLog();
+    if (std::find(sessions_.begin(), sessions_.end(), session) == sessions_.end())
+        sessions_.push_back(session);
+}
+
+void BluescanBluetoothLowEnergyCallback::Detach(ScanSession* session)
+{
+    DrainLog();
+    sessions_.erase(std::remove(sessions_.begin(), sessions_.end(), session), sessions_.end());
+}
+
+void BluescanBluetoothLowEnergyCallback::CopyScanResults(ScanSession* session, std::vector<BeaconSample>& copy)
+{
+    DrainLog();
+    results_.clear();
+    session->table.ForEach([this](uint64_t address, const RssiStats& stats) {
+        results_.push_back({address, &stats, 0});
+    });
+    int64_t now_ms = MonotonicMs();
+    FormatResults(session, results_, now_ms, copy);
+    session->table.Clear();
+    ExpireInfo(now_ms);
+}
+
+void BluescanBluetoothLowEnergyCallback::FormatResults(ScanSession* session,
+                                                       BeaconList& results,
+                                                       int64_t timestamp_ms,
+                                                       std::vector<BeaconSample>& copy)
+{
+    // Strongest first by reported RSSI. Beacons reported last time get a
+    // bonus so the set does not flip between windows on noise alone.
+    for (Candidate& candidate : results) {
+        candidate.score = ReportedRssi(*candidate.stats);
+        if (std::binary_search(session->selected.begin(), session->selected.end(), candidate.address))
+            candidate.score += navigator::BeaconHysteresisDb;
+    }
+
+    size_t n = std::min(results.size(), static_cast<size_t>(navigator::MaxScanBeacons));
+    std::partial_sort(results.begin(), results.begin() + n, results.end(),
+                      [](const Candidate& a, const Candidate& b) {
+                          if (a.score != b.score)
+                              return a.score > b.score;
+                          return a.address < b.address;
+                      });
+
+    session->selected.clear();
+    for (size_t i = 0; i < n; i++) {
+        const Candidate& candidate = results[i];
+        session->selected.push_back(candidate.address);
+
+        const RssiStats& stats = *candidate.stats;
+        BeaconSample sample;
+        sample.address = candidate.address;
+        sample.timestamp_ms = timestamp_ms;
+        sample.count = stats.count();
+        sample.rssi = sample.median = stats.median();
+        sample.min = stats.min();
+        sample.max = stats.max();
+        sample.mean = stats.mean();
+        sample.variance = stats.variance();
+        sample.ewma = stats.ewma();
+        FillIdentity(candidate.address, &sample);
+        copy.push_back(sample);
+    }
+    std::sort(session->selected.begin(), session->selected.end());
+}
+
+void BluescanBluetoothLowEnergyCallback::StartContinuous(ScanSession* session, int window_ms)
+{
+    DrainLog();
+    int bucket_ms = window_ms / kWindowBuckets;
+    session->window.reset(new SlidingWindow(window_ms, bucket_ms));
+    session->table.Clear();
+}
+
+void BluescanBluetoothLowEnergyCallback::StopContinuous(ScanSession* session)
+{
+    session->window.reset();
+}
+
+void BluescanBluetoothLowEnergyCallback::CopySnapshot(ScanSession* session, std::vector<BeaconSample>& copy)
+{
+    if (!session->window)
+        return;
+
+    DrainLog();
+    std::map<uint64_t,RssiStats> snapshot;
+    int64_t now_ms = MonotonicMs();
+    session->window->Snapshot(now_ms, &snapshot);
+
+    results_.clear();
+    for (const auto& entry : snapshot)
+        results_.push_back({entry.first, &entry.second, 0});
+    FormatResults(session, results_, now_ms, copy);
+    ExpireInfo(now_ms);
+}
+
+void BluescanBluetoothLowEnergyCallback::StartStreaming(ScanSession* session, size_t batch_size,
+                                                        const base::Closure& on_batch_full)
+{
+    DrainLog();
+    session->streaming = true;
+    session->stream_batch_size = batch_size;
+    session->on_batch_full = on_batch_full;
+    session->stream.clear();
+    session->stream.reserve(batch_size);
+}
+
+void BluescanBluetoothLowEnergyCallback::StopStreaming(ScanSession* session)
+{
+    session->streaming = false;
+    session->on_batch_full.Reset();
+}
+
+void BluescanBluetoothLowEnergyCallback::TakeStreamBatch(ScanSession* session, std::vector<BeaconSample>& batch)
+{
+    DrainLog();
+    batch.swap(session->stream);
+    session->stream.clear();
+    session->stream.reserve(session->stream_batch_size);
 }
   
 void BluescanBluetoothLowEnergyCallback::OnClientRegistered(int status, int client_id) {
     if (status != bluetooth::BLE_STATUS_SUCCESS) {
         LOG(ERROR) << "Failed to register BLE client";
-        ble_registered = false;
+        registered_ = false;
     } else {
-        ble_registered = true;
-        ble_client_id = client_id;
+        client_id_ = client_id;
+        registered_ = true;
         LOG(INFO) << "Client registered with id: " << client_id;
     }
 }
@@ -6,22 +6,31 @@
 #include <bluetooth/binder/IBluetoothLowEnergyCallback.h>
 #include <bluetooth/low_energy_constants.h>
 #include <bluetooth/adapter_state.h>
-#include <utils/String16.h>
-#include <string>
+#include <base/callback.h>
+#include <base/time/time.h>
+#include <array>
+#include <atomic>
 #include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "beacon_sample.h"
+#include "beacon_table.h"
+#include "eddystone.h"
+#include "rssi_stats.h"
+#include "scan_log.h"
+#include "scan_session.h"
+#include "sliding_window.h"
 
 using ipc::binder::IBluetooth;
 using ipc::binder::IBluetoothLowEnergy;
 using android::sp;
-
-extern volatile bluetooth::AdapterState state;
-extern volatile bool ble_registered;
-extern volatile int ble_client_id;
-
-extern sp<IBluetooth> bt_iface;
-extern sp<IBluetoothLowEnergy> ble_iface;
+using navigator::services::bluescan::BeaconSample;
 
 namespace bluescan {
+
     
 class BluescanBluetoothCallback : public ipc::binder::BnBluetoothCallback {
 public:
@@ -33,24 +42,116 @@ public:
       bluetooth::AdapterState prev_state,
       bluetooth::AdapterState new_state) override;
 
+    bluetooth::AdapterState state() const { return state_; }
+
 private:
+    std::atomic<bluetooth::AdapterState> state_{bluetooth::ADAPTER_STATE_DISCONNECTED};
     DISALLOW_COPY_AND_ASSIGN(BluescanBluetoothCallback);
 };
 
 class BluescanBluetoothLowEnergyCallback : public ipc::binder::BnBluetoothLowEnergyCallback {
 public:
-    BluescanBluetoothLowEnergyCallback() = default;
+    BluescanBluetoothLowEnergyCallback();
     ~BluescanBluetoothLowEnergyCallback() override = default;
 
+    // OnScanResult may run on any binder thread, it only appends to the
+    // scan log. Every other method belongs to the message loop, which
+    // folds the log into the results with Drain.
     void OnScanResult(const bluetooth::ScanResult& scan_result) override;
     void OnClientRegistered(int status, int client_id) override;
     void OnConnectionState(int /*status*/, int /*client_id*/, const char* /*address*/, bool /*connected*/) override {};
     void OnMtuChanged(int /*status*/, const char* /*address*/, int /*mtu*/) override {};
     void OnMultiAdvertiseCallback(int /*status*/, bool /*is_start*/, const bluetooth::AdvertiseSettings& /*settings*/) override {};
-    void CopyScanResults(std::vector<android::String16>& copy);
+
+    // Folds the log into the sessions and runs on_batch_full of the
+    // sessions with a full stream batch
+    void Drain();
+
+    bool registered() const { return registered_; }
+    int client_id() const { return client_id_; }
+
+    // Advertisements are only added to attached sessions. The session is
+    // owned by the caller and must be detached before it goes away.
+    void Attach(ScanSession* session);
+    void Detach(ScanSession* session);
+
+    // Reports the one-shot window of session and starts a new one
+    void CopyScanResults(ScanSession* session, std::vector<BeaconSample>& copy);
+
+    // Streaming mode: every advertisement is also queued for OnScanBatch.
+    // on_batch_full runs as soon as batch_size samples are queued.
+    void StartStreaming(ScanSession* session, size_t batch_size, const base::Closure& on_batch_full);
+    void StopStreaming(ScanSession* session);
+    void TakeStreamBatch(ScanSession* session, std::vector<BeaconSample>& batch);
+
+    // Continuous mode: advertisements feed a sliding window of window_ms
+    // that CopySnapshot aggregates on demand.
+    void StartContinuous(ScanSession* session, int window_ms);
+    void StopContinuous(ScanSession* session);
+    void CopySnapshot(ScanSession* session, std::vector<BeaconSample>& copy);
+
+    // Only keep Eddystone beacons from these namespaces (concatenated
+    // 10-byte IDs). Empty accepts every beacon.
+    bool SetAllowedNamespaces(const std::vector<int8_t>& namespaces);
 
 private:
-    std::map<std::string,int> scanResults_;
+    // What the Eddystone frames of a beacon told us
+    struct BeaconInfo {
+        bool has_uid = false;
+        uint8_t uid[kEddystoneNamespaceSize + kEddystoneInstanceSize];
+        // Address the UID frames last came from
+        uint64_t address = 0;
+        bool has_tx_power = false;
+        int8_t tx_power = 0;
+        bool has_telemetry = false;
+        uint16_t battery_mv = 0;
+        float temperature = 0.0f;
+        int64_t last_seen_ms = 0;
+    };
+
+    // Frame key of the beacon that last sent a UID frame from an address
+    struct AddressKey {
+        uint64_t key;
+        int64_t last_seen_ms;
+    };
+
+    // Drain without running on_batch_full, for the methods a flush
+    // itself calls
+    void DrainLog();
+    void Consume(const ScanLogEntry& entry);
+
+    // Table key of an advertisement: the UID frame key when there is one,
+    // the address otherwise. Returns false if it is filtered out.
+    bool IdentifyBeacon(const ScanLogEntry& entry, uint64_t* key);
+    void FillIdentity(uint64_t key, BeaconSample* sample) const;
+    void ExpireInfo(int64_t now_ms);
+
+    struct Candidate {
+        uint64_t address;
+        const RssiStats* stats;
+        // Selection rank, higher is better
+        int score;
+    };
+    typedef std::vector<Candidate> BeaconList;
+
+    // Reports the navigator::MaxScanBeacons strongest beacons of results
+    void FormatResults(ScanSession* session,
+                       BeaconList& results,
+                       int64_t timestamp_ms,
+                       std::vector<BeaconSample>& copy);
+
+    std::atomic<bool> registered_{false};
+    std::atomic<int> client_id_{0};
+
+    ScanLog log_;
+    uint64_t reported_dropped_ = 0;
+
+    std::vector<ScanSession*> sessions_;
+    BeaconList results_;
+
+    std::unordered_map<uint64_t, BeaconInfo> info_;
+    std::unordered_map<uint64_t, AddressKey> address_keys_;
+    std::vector<std::array<uint8_t, kEddystoneNamespaceSize>> allowed_namespaces_;
     DISALLOW_COPY_AND_ASSIGN(BluescanBluetoothLowEnergyCallback);
 };
 
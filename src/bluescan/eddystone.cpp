@@ -0,0 +1,129 @@
+#include "eddystone.h"
+
+#include <math.h>
+
+namespace bluescan {
+
+namespace {
+
+const uint8_t kServiceData16 = 0x16;
+const uint8_t kEddystoneUuidLow = 0xAA;
+const uint8_t kEddystoneUuidHigh = 0xFE;
+
+const uint8_t kFrameUid = 0x00;
+const uint8_t kFrameUrl = 0x10;
+const uint8_t kFrameTlm = 0x20;
+const uint8_t kFrameEid = 0x30;
+
+// Minimum frame sizes, frame type byte included
+const size_t kUidFrameSize = 2 + kEddystoneNamespaceSize + kEddystoneInstanceSize;
+const size_t kUrlFrameSize = 3;
+const size_t kTlmFrameSize = 14;
+const size_t kEidFrameSize = 2 + kEddystoneEidSize;
+
+const float kPathLossAt1m = 41.0f;
+const float kPathLossExponent = 2.0f;
+
+uint64_t Fnv1a(const uint8_t* data, size_t length, uint64_t hash)
+{
+    for (size_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+const uint64_t kFnvOffset = 0xcbf29ce484222325ULL;
+const uint64_t kFrameKeyBit = 1ULL << 63;
+
+}  // anonymous namespace
+
+bool ParseEddystone(const uint8_t* record, size_t length, EddystoneFrame* frame)
+{
+    const uint8_t* data;
+    size_t data_length;
+    return FindEddystoneFrame(record, length, &data, &data_length) &&
+           ParseEddystoneFrame(data, data_length, frame);
+}
+
+bool FindEddystoneFrame(const uint8_t* record, size_t length,
+                        const uint8_t** data, size_t* data_length)
+{
+    // AD structures: length byte (covering type and data), type, data
+    size_t i = 0;
+    while (i < length) {
+        size_t size = record[i];
+        if (size == 0 || i + 1 + size > length)
+            return false;
+
+        const uint8_t* ad_data = record + i + 2;
+        size_t ad_length = size - 1;
+        if (record[i + 1] == kServiceData16 && ad_length >= 2 &&
+            ad_data[0] == kEddystoneUuidLow && ad_data[1] == kEddystoneUuidHigh) {
+            *data = ad_data + 2;
+            *data_length = ad_length - 2;
+            return true;
+        }
+
+        i += 1 + size;
+    }
+    return false;
+}
+
+bool ParseEddystoneFrame(const uint8_t* data, size_t length, EddystoneFrame* frame)
+{
+    if (length < 1)
+        return false;
+
+    switch (data[0]) {
+    case kFrameUid:
+        if (length < kUidFrameSize)
+            return false;
+        frame->type = EddystoneFrameType::kUid;
+        frame->tx_power = static_cast<int8_t>(data[1]);
+        frame->namespace_id = data + 2;
+        frame->instance_id = data + 2 + kEddystoneNamespaceSize;
+        return true;
+
+    case kFrameUrl:
+        if (length < kUrlFrameSize)
+            return false;
+        frame->type = EddystoneFrameType::kUrl;
+        frame->tx_power = static_cast<int8_t>(data[1]);
+        return true;
+
+    case kFrameTlm:
+        // Version 0 is plain text, version 1 (ETLM) is encrypted
+        if (length < kTlmFrameSize || data[1] != 0)
+            return false;
+        frame->type = EddystoneFrameType::kTlm;
+        frame->battery_mv = static_cast<uint16_t>(data[2] << 8 | data[3]);
+        // Signed 8.8 fixed point, big endian
+        frame->temperature = static_cast<int16_t>(data[4] << 8 | data[5]) / 256.0f;
+        return true;
+
+    case kFrameEid:
+        if (length < kEidFrameSize)
+            return false;
+        frame->type = EddystoneFrameType::kEid;
+        frame->tx_power = static_cast<int8_t>(data[1]);
+        frame->eid = data + 2;
+        return true;
+    }
+
+    return false;
+}
+
+uint64_t UidKey(const uint8_t* namespace_id, const uint8_t* instance_id)
+{
+    uint64_t hash = Fnv1a(namespace_id, kEddystoneNamespaceSize, kFnvOffset);
+    return Fnv1a(instance_id, kEddystoneInstanceSize, hash) | kFrameKeyBit;
+}
+
+float EstimateDistance(int tx_power, int rssi)
+{
+    float loss = static_cast<float>(tx_power - rssi) - kPathLossAt1m;
+    return powf(10.0f, loss / (10.0f * kPathLossExponent));
+}
+
+} // namespace bluescan
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace bluescan {
+
+const size_t kEddystoneNamespaceSize = 10;
+const size_t kEddystoneInstanceSize = 6;
+const size_t kEddystoneEidSize = 8;
+// Largest frame, a UID frame with its reserved bytes
+const size_t kEddystoneMaxFrameSize = 20;
+
+enum class EddystoneFrameType {
+    kUid,
+    kUrl,
+    kTlm,
+    kEid,
+};
+
+// View of the Eddystone frame found in a scan record. The pointers refer
+// into the record, nothing is copied, so the frame is only valid as long
+// as the record is.
+struct EddystoneFrame {
+    EddystoneFrameType type;
+
+    // UID, URL and EID: calibrated TX power at 0 m, in dBm
+    int8_t tx_power;
+
+    // UID
+    const uint8_t* namespace_id;
+    const uint8_t* instance_id;
+
+    // EID
+    const uint8_t* eid;
+
+    // Unencrypted TLM. battery_mv is 0 and temperature -128 when the
+    // beacon does not report them.
+    uint16_t battery_mv;
+    float temperature;
+};
+
+// Looks for Eddystone service data (UUID 0xFEAA) among the AD structures
+// of a raw advertisement. Returns false if there is none, if the frame is
+// truncated or of an unknown type, or if it is an encrypted TLM.
+bool ParseEddystone(const uint8_t* record, size_t length, EddystoneFrame* frame);
+
+// The two steps of ParseEddystone: locating the frame (the service data
+// after the UUID) in the record, and decoding it.
+bool FindEddystoneFrame(const uint8_t* record, size_t length,
+                        const uint8_t** data, size_t* data_length);
+bool ParseEddystoneFrame(const uint8_t* data, size_t length, EddystoneFrame* frame);
+
+// Table key for beacons identified by their UID frames rather than their
+// address. Addresses only use the low 48 bits, this sets the top bit.
+uint64_t UidKey(const uint8_t* namespace_id, const uint8_t* instance_id);
+inline bool IsAddressKey(uint64_t key) { return !(key >> 63); }
+
+// Distance in metres from the path loss between the calibrated 0 m power
+// and the received power (log-distance model, exponent 2, 41 dB loss over
+// the first metre).
+float EstimateDistance(int tx_power, int rssi);
+
+} // namespace bluescan
@@ -0,0 +1,81 @@
+#include "rssi_stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace bluescan {
+
+namespace {
+// Weight of the newest reading in the exponentially weighted average
+const double kEwmaAlpha = 0.2;
+}  // anonymous namespace
+
+const int RssiStats::kMedianSamples;
+
+void RssiStats::Add(int rssi)
+{
+    if (count_ == 0) {
+        min_ = max_ = rssi;
+        ewma_ = rssi;
+    } else {
+        min_ = std::min(min_, rssi);
+        max_ = std::max(max_, rssi);
+        ewma_ += kEwmaAlpha * (rssi - ewma_);
+    }
+
+    count_++;
+    double delta = rssi - mean_;
+    mean_ += delta / count_;
+    m2_ += delta * (rssi - mean_);
+
+    PushRecent(static_cast<int8_t>(rssi));
+}
+
+void RssiStats::Merge(const RssiStats& newer)
+{
+    if (newer.count_ == 0)
+        return;
+    if (count_ == 0) {
+        *this = newer;
+        return;
+    }
+
+    int n = count_ + newer.count_;
+    double delta = newer.mean_ - mean_;
+    mean_ += delta * newer.count_ / n;
+    m2_ += newer.m2_ + delta * delta * count_ * newer.count_ / n;
+    min_ = std::min(min_, newer.min_);
+    max_ = std::max(max_, newer.max_);
+
+    // Same decay as if the newer samples had been added one by one,
+    // assuming their own average started from ours
+    double keep = std::pow(1.0 - kEwmaAlpha, newer.count_);
+    ewma_ = ewma_ * keep + newer.ewma_ * (1.0 - keep);
+    count_ = n;
+
+    int first = newer.recent_size_ < kMedianSamples ? 0 : newer.recent_next_;
+    for (int i = 0; i < newer.recent_size_; i++)
+        PushRecent(newer.recent_[(first + i) % kMedianSamples]);
+}
+
+int RssiStats::median() const
+{
+    if (recent_size_ == 0)
+        return 0;
+
+    int8_t sorted[kMedianSamples];
+    std::copy(recent_, recent_ + recent_size_, sorted);
+    int8_t* mid = sorted + recent_size_ / 2;
+    std::nth_element(sorted, mid, sorted + recent_size_);
+    return *mid;
+}
+
+void RssiStats::PushRecent(int8_t rssi)
+{
+    recent_[recent_next_] = rssi;
+    recent_next_ = (recent_next_ + 1) % kMedianSamples;
+    if (recent_size_ < kMedianSamples)
+        recent_size_++;
+}
+
+} // namespace bluescan
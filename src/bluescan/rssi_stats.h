@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace bluescan {
+
+// Streaming RSSI statistics of one beacon: count, mean and variance
+// (Welford), min/max, median of the most recent samples and an
+// exponentially weighted average. Constant size, no allocation.
+class RssiStats {
+public:
+    RssiStats() = default;
+
+    void Add(int rssi);
+
+    // Folds in statistics gathered after the ones already held, as done
+    // when the buckets of a sliding window are combined oldest first.
+    void Merge(const RssiStats& newer);
+
+    int count() const { return count_; }
+    double mean() const { return mean_; }
+    double variance() const { return count_ > 1 ? m2_ / (count_ - 1) : 0.0; }
+    int min() const { return min_; }
+    int max() const { return max_; }
+    double ewma() const { return ewma_; }
+
+    // Median of the last kMedianSamples readings
+    int median() const;
+
+    static const int kMedianSamples = 15;
+
+private:
+    void PushRecent(int8_t rssi);
+
+    int count_ = 0;
+    double mean_ = 0.0;
+    double m2_ = 0.0;
+    int min_ = 0;
+    int max_ = 0;
+    double ewma_ = 0.0;
+
+    // Ring of recent readings, recent_next_ is the oldest once full
+    int8_t recent_[kMedianSamples] = {};
+    int recent_size_ = 0;
+    int recent_next_ = 0;
+};
+
+} // namespace bluescan
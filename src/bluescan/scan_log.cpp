@@ -0,0 +1,54 @@
+#include "scan_log.h"
+
+#include <thread>
+
+namespace bluescan {
+
+ScanLog::ScanLog(size_t capacity)
+    : capacity_(capacity)
+{
+    for (Buffer& buffer : buffers_)
+        buffer.entries.reset(new ScanLogEntry[capacity]);
+}
+
+bool ScanLog::Append(const ScanLogEntry& entry)
+{
+    while (true) {
+        int index = active_.load();
+        Buffer& buffer = buffers_[index];
+
+        // Announce ourselves before checking the buffer is still active.
+        // Both this pair and the store/load pair in Retire are sequentially
+        // consistent, so either Retire sees the writer or the writer sees
+        // the swap and moves to the new buffer.
+        buffer.writers.fetch_add(1);
+        if (active_.load() != index) {
+            buffer.writers.fetch_sub(1);
+            continue;
+        }
+
+        size_t slot = buffer.size.fetch_add(1, std::memory_order_relaxed);
+        bool stored = slot < capacity_;
+        if (stored)
+            buffer.entries[slot] = entry;
+        else
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+
+        // Release publishes the entry to the Retire that waits on writers
+        buffer.writers.fetch_sub(1, std::memory_order_release);
+        return stored;
+    }
+}
+
+ScanLog::Buffer& ScanLog::Retire()
+{
+    int index = active_.load(std::memory_order_relaxed);
+    active_.store(1 - index);
+
+    Buffer& retired = buffers_[index];
+    while (retired.writers.load() != 0)
+        std::this_thread::yield();
+    return retired;
+}
+
+} // namespace bluescan
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "eddystone.h"
+
+namespace bluescan {
+
+// One advertisement as handed from the binder threads to the message loop
+struct ScanLogEntry {
+    uint64_t address;
+    int64_t timestamp_ms;
+    int8_t rssi;
+    // Eddystone frame copied out of the scan record, empty if none
+    uint8_t frame_length;
+    uint8_t frame[kEddystoneMaxFrameSize];
+};
+
+// Multi-producer, single-consumer hand-over of advertisements. Producers
+// append to the active buffer with one fetch_add and never wait. The
+// consumer makes the other buffer active, waits until producers that were
+// still writing into the retired one are done and then reads it without
+// any further synchronisation.
+class ScanLog {
+public:
+    // Entries per buffer, appends beyond that are dropped until the next
+    // Drain
+    explicit ScanLog(size_t capacity);
+
+    // Any thread. Returns false if the entry was dropped.
+    bool Append(const ScanLogEntry& entry);
+
+    // Consumer thread only. Calls f(entry) for every entry appended since
+    // the previous Drain.
+    template <typename F>
+    void Drain(F f)
+    {
+        Buffer& retired = Retire();
+        size_t n = std::min(retired.size.load(std::memory_order_relaxed), capacity_);
+        for (size_t i = 0; i < n; i++)
+            f(retired.entries[i]);
+        retired.size.store(0, std::memory_order_relaxed);
+    }
+
+    // Entries dropped because a buffer was full, since construction
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Buffer {
+        std::unique_ptr<ScanLogEntry[]> entries;
+        // Slots handed out, may exceed the capacity when full
+        std::atomic<size_t> size{0};
+        // Producers currently inside this buffer
+        std::atomic<int> writers{0};
+    };
+
+    Buffer& Retire();
+
+    size_t capacity_;
+    Buffer buffers_[2];
+    std::atomic<int> active_{0};
+    std::atomic<uint64_t> dropped_{0};
+};
+
+} // namespace bluescan
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include <base/callback.h>
+
+#include "beacon_sample.h"
+#include "beacon_table.h"
+#include "sliding_window.h"
+
+namespace bluescan {
+
+// Results of one client session of the service. The BLE callback
+// identifies every advertisement once and adds it to each attached
+// session, so sessions scan side by side over the same radio scan.
+struct ScanSession {
+    // Beacons tracked per one-shot window, further ones are ignored
+    static const size_t kMaxTrackedBeacons = 256;
+
+    // One-shot window results, unused while window is set
+    BeaconTable table{kMaxTrackedBeacons};
+
+    // Continuous mode window
+    std::unique_ptr<SlidingWindow> window;
+
+    // Streaming mode queue, on_batch_full runs once it holds batch_size
+    // samples
+    bool streaming = false;
+    size_t stream_batch_size = 0;
+    base::Closure on_batch_full;
+    std::vector<navigator::services::bluescan::BeaconSample> stream;
+
+    // Beacons reported last time, sorted, for selection hysteresis
+    std::vector<uint64_t> selected;
+};
+
+} // namespace bluescan
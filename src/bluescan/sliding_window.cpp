@@ -0,0 +1,61 @@
+#include "sliding_window.h"
+
+#include <algorithm>
+
+namespace bluescan {
+
+SlidingWindow::SlidingWindow(int window_ms, int bucket_ms)
+    : bucket_ms_(bucket_ms > 0 ? bucket_ms : 1)
+{
+    num_buckets_ = (window_ms + bucket_ms_ - 1) / bucket_ms_;
+    if (num_buckets_ == 0)
+        num_buckets_ = 1;
+}
+
+void SlidingWindow::Add(uint64_t address, int rssi, int64_t now_ms)
+{
+    std::vector<Bucket>& ring = beacons_[address];
+    if (ring.empty())
+        ring.assign(num_buckets_, Bucket{-1, RssiStats()});
+
+    int64_t index = BucketIndex(now_ms);
+    Bucket& bucket = ring[index % num_buckets_];
+    if (bucket.index != index) {
+        // Slot still holds an expired bucket, recycle it
+        bucket.index = index;
+        bucket.stats = RssiStats();
+    }
+    bucket.stats.Add(rssi);
+}
+
+void SlidingWindow::Snapshot(int64_t now_ms, std::map<uint64_t,RssiStats>* out)
+{
+    int64_t newest = BucketIndex(now_ms);
+    int64_t oldest = newest - static_cast<int64_t>(num_buckets_) + 1;
+
+    auto it = beacons_.begin();
+    while (it != beacons_.end()) {
+        // Oldest bucket first, so recent-sample statistics stay in order
+        RssiStats stats;
+        for (int64_t index = std::max<int64_t>(oldest, 0); index <= newest; index++) {
+            const Bucket& bucket = it->second[index % num_buckets_];
+            if (bucket.index == index)
+                stats.Merge(bucket.stats);
+        }
+
+        if (stats.count() == 0) {
+            it = beacons_.erase(it);
+            continue;
+        }
+
+        (*out)[it->first] = stats;
+        ++it;
+    }
+}
+
+void SlidingWindow::Clear()
+{
+    beacons_.clear();
+}
+
+} // namespace bluescan
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+#include "rssi_stats.h"
+
+namespace bluescan {
+
+// Per-beacon RSSI readings over the last window_ms milliseconds, kept in
+// fixed-size time buckets so old readings expire without being stored one
+// by one.
+class SlidingWindow {
+public:
+    SlidingWindow(int window_ms, int bucket_ms);
+
+    void Add(uint64_t address, int rssi, int64_t now_ms);
+
+    // Statistics of every beacon heard inside the window ending at now_ms.
+    // Beacons whose buckets have all expired are dropped.
+    void Snapshot(int64_t now_ms, std::map<uint64_t,RssiStats>* out);
+
+    void Clear();
+
+private:
+    struct Bucket {
+        int64_t index;
+        RssiStats stats;
+    };
+
+    int64_t BucketIndex(int64_t now_ms) const { return now_ms / bucket_ms_; }
+
+    int bucket_ms_;
+    size_t num_buckets_;
+    std::map<uint64_t, std::vector<Bucket>> beacons_;
+};
+
+} // namespace bluescan
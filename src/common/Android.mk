@@ -9,6 +9,8 @@ LOCAL_SRC_FILES := \
 	aidl/navigator/services/screen/IScreenService.aidl \
 	aidl/navigator/services/bluescan/IBluescanService.aidl \
 	aidl/navigator/services/bluescan/IBluescanCallback.aidl \
+	beacon_address.cpp \
+	beacon_sample.cpp \
 	binder_constants.cpp \
 	navigator_constants.cpp \
 
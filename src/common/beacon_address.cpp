@@ -0,0 +1,76 @@
+#include "beacon_address.h"
+
+#include <stdio.h>
+
+namespace navigator {
+namespace services {
+namespace bluescan {
+
+namespace {
+
+// Value of every hex digit, -1 for anything else. Parsing runs once per
+// advertisement, so it avoids the compare chain of a digit function.
+class HexTable {
+public:
+    HexTable()
+    {
+        for (int c = 0; c < 256; c++)
+            values_[c] = -1;
+        for (int c = '0'; c <= '9'; c++)
+            values_[c] = c - '0';
+        for (int c = 'a'; c <= 'f'; c++)
+            values_[c] = c - 'a' + 10;
+        for (int c = 'A'; c <= 'F'; c++)
+            values_[c] = c - 'A' + 10;
+    }
+
+    int operator[](char c) const { return values_[static_cast<unsigned char>(c)]; }
+
+private:
+    signed char values_[256];
+};
+
+const HexTable kHexDigits;
+
+}  // anonymous namespace
+
+bool ParseAddress(const std::string& text, uint64_t* address)
+{
+    if (text.size() != 17)
+        return false;
+
+    const char* p = text.data();
+    uint64_t value = 0;
+    int invalid = 0;
+    for (int i = 0; i < 6; i++, p += 3) {
+        int hi = kHexDigits[p[0]];
+        int lo = kHexDigits[p[1]];
+        // Negative digits show up in the sign bit, checked once at the end.
+        // Until then combine them unsigned, shifting -1 is undefined.
+        invalid |= hi | lo;
+        value = (value << 8) | ((static_cast<unsigned>(hi) << 4 | static_cast<unsigned>(lo)) & 0xff);
+    }
+    if (invalid < 0 || text[2] != ':' || text[5] != ':' || text[8] != ':' ||
+        text[11] != ':' || text[14] != ':')
+        return false;
+
+    *address = value;
+    return true;
+}
+
+std::string FormatAddress(uint64_t address)
+{
+    char text[18];
+    snprintf(text, sizeof(text), "%02X:%02X:%02X:%02X:%02X:%02X",
+             static_cast<unsigned>(address >> 40) & 0xff,
+             static_cast<unsigned>(address >> 32) & 0xff,
+             static_cast<unsigned>(address >> 24) & 0xff,
+             static_cast<unsigned>(address >> 16) & 0xff,
+             static_cast<unsigned>(address >> 8) & 0xff,
+             static_cast<unsigned>(address) & 0xff);
+    return text;
+}
+
+}  // namespace bluescan
+}  // namespace services
+}  // namespace navigator
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+namespace navigator {
+namespace services {
+namespace bluescan {
+
+// A 48-bit MAC address packed into the low six bytes of a uint64_t, first
+// octet most significant, so packed addresses sort like their text form.
+
+// "AA:BB:CC:DD:EE:FF" <-> packed address. ParseAddress returns false
+// and leaves *address untouched if text is not a MAC address.
+bool ParseAddress(const std::string& text, uint64_t* address);
+std::string FormatAddress(uint64_t address);
+
+}  // namespace bluescan
+}  // namespace services
+}  // namespace navigator
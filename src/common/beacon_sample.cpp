@@ -0,0 +1,82 @@
+#include "beacon_sample.h"
+
+namespace navigator {
+namespace services {
+namespace bluescan {
+
+android::status_t BeaconSample::writeToParcel(android::Parcel* parcel) const
+{
+    // The four int8 readings share one parcel word
+    uint32_t readings = static_cast<uint8_t>(rssi)
+                      | static_cast<uint8_t>(median) << 8
+                      | static_cast<uint8_t>(min) << 16
+                      | static_cast<uint32_t>(static_cast<uint8_t>(max)) << 24;
+    int64_t packed = static_cast<int64_t>(address);
+
+    // Presence flags, TX power and battery share another one
+    uint32_t eddystone = (has_uid ? 1 : 0) | (has_tx_power ? 2 : 0) | (has_telemetry ? 4 : 0)
+                       | static_cast<uint8_t>(tx_power) << 8
+                       | static_cast<uint32_t>(battery_mv) << 16;
+    int64_t uid_words[2];
+    memcpy(uid_words, uid, sizeof(uid));
+
+    android::status_t status;
+    if ((status = parcel->writeInt64(packed)) != android::OK ||
+        (status = parcel->writeInt64(static_cast<int64_t>(last_address))) != android::OK ||
+        (status = parcel->writeInt64(timestamp_ms)) != android::OK ||
+        (status = parcel->writeInt32(count)) != android::OK ||
+        (status = parcel->writeInt32(static_cast<int32_t>(readings))) != android::OK ||
+        (status = parcel->writeFloat(mean)) != android::OK ||
+        (status = parcel->writeFloat(variance)) != android::OK ||
+        (status = parcel->writeFloat(ewma)) != android::OK ||
+        (status = parcel->writeInt32(static_cast<int32_t>(eddystone))) != android::OK ||
+        (status = parcel->writeInt64(uid_words[0])) != android::OK ||
+        (status = parcel->writeInt64(uid_words[1])) != android::OK ||
+        (status = parcel->writeFloat(distance)) != android::OK ||
+        (status = parcel->writeFloat(temperature)) != android::OK)
+        return status;
+    return android::OK;
+}
+
+android::status_t BeaconSample::readFromParcel(const android::Parcel* parcel)
+{
+    int64_t packed;
+    int64_t last_packed;
+    int32_t readings;
+    int32_t eddystone;
+    int64_t uid_words[2];
+
+    android::status_t status;
+    if ((status = parcel->readInt64(&packed)) != android::OK ||
+        (status = parcel->readInt64(&last_packed)) != android::OK ||
+        (status = parcel->readInt64(&timestamp_ms)) != android::OK ||
+        (status = parcel->readInt32(&count)) != android::OK ||
+        (status = parcel->readInt32(&readings)) != android::OK ||
+        (status = parcel->readFloat(&mean)) != android::OK ||
+        (status = parcel->readFloat(&variance)) != android::OK ||
+        (status = parcel->readFloat(&ewma)) != android::OK ||
+        (status = parcel->readInt32(&eddystone)) != android::OK ||
+        (status = parcel->readInt64(&uid_words[0])) != android::OK ||
+        (status = parcel->readInt64(&uid_words[1])) != android::OK ||
+        (status = parcel->readFloat(&distance)) != android::OK ||
+        (status = parcel->readFloat(&temperature)) != android::OK)
+        return status;
+
+    address = static_cast<uint64_t>(packed);
+    last_address = static_cast<uint64_t>(last_packed);
+    rssi = static_cast<int8_t>(readings);
+    median = static_cast<int8_t>(readings >> 8);
+    min = static_cast<int8_t>(readings >> 16);
+    max = static_cast<int8_t>(readings >> 24);
+    has_uid = eddystone & 1;
+    has_tx_power = eddystone & 2;
+    has_telemetry = eddystone & 4;
+    tx_power = static_cast<int8_t>(eddystone >> 8);
+    battery_mv = static_cast<uint16_t>(static_cast<uint32_t>(eddystone) >> 16);
+    memcpy(uid, uid_words, sizeof(uid));
+    return android::OK;
+}
+
+}  // namespace bluescan
+}  // namespace services
+}  // namespace navigator
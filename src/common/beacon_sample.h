@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <binder/Parcel.h>
+#include <binder/Parcelable.h>
+
+#include "beacon_address.h"
+
+namespace navigator {
+namespace services {
+namespace bluescan {
+
+// One beacon as delivered by the bluescan service, either a single
+// advertisement (streaming, count == 1) or the summary of a scan window.
+// The address is packed as described in beacon_address.h, except for
+// Eddystone beacons identified by their UID frames: those carry a 64-bit
+// key with the top bit set, and last_address holds the address they last
+// advertised from. EID beacons keep their address. Timestamps are
+// CLOCK_MONOTONIC milliseconds.
+class BeaconSample : public android::Parcelable {
+public:
+    BeaconSample() = default;
+
+    android::status_t writeToParcel(android::Parcel* parcel) const override;
+    android::status_t readFromParcel(const android::Parcel* parcel) override;
+
+    uint64_t address = 0;
+    uint64_t last_address = 0;
+    int64_t timestamp_ms = 0;
+    int32_t count = 0;
+
+    // Reading of a single advertisement, median over a window
+    int8_t rssi = 0;
+    int8_t median = 0;
+    int8_t min = 0;
+    int8_t max = 0;
+
+    float mean = 0.0f;
+    float variance = 0.0f;
+    float ewma = 0.0f;
+
+    // Eddystone UID, namespace followed by instance
+    bool has_uid = false;
+    uint8_t uid[16] = {};
+
+    // Calibrated TX power at 0 m and the distance in metres derived from it
+    bool has_tx_power = false;
+    int8_t tx_power = 0;
+    float distance = 0.0f;
+
+    // Last unencrypted Eddystone TLM
+    bool has_telemetry = false;
+    uint16_t battery_mv = 0;
+    float temperature = 0.0f;
+};
+
+}  // namespace bluescan
+}  // namespace services
+}  // namespace navigator
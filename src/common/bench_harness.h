@@ -0,0 +1,159 @@
+#pragma once
+
+// Shared pieces of the host benchmarks: the --filter, --min-time-ms and
+// --out flags, the timing loop and the JSON report, so runs of every
+// benchmark read and diff the same way.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace harness {
+
+class Options {
+public:
+    explicit Options(double min_time_ms)
+        : min_time_ms(min_time_ms)
+    {
+    }
+
+    // Integer flag of the benchmark itself, listed before the common ones
+    void AddFlag(const char* flag, int* value)
+    {
+        flags_.push_back(std::make_pair(std::string(flag), value));
+    }
+
+    // Prints the usage and returns false on anything it does not know
+    bool Parse(int argc, char* argv[])
+    {
+        for (int i = 1; i < argc; i++) {
+            if (i + 1 >= argc)
+                return Usage(argv[0]);
+            if (!strcmp(argv[i], "--filter")) {
+                filter = argv[++i];
+            } else if (!strcmp(argv[i], "--min-time-ms")) {
+                min_time_ms = atof(argv[++i]);
+            } else if (!strcmp(argv[i], "--out")) {
+                out_path = argv[++i];
+            } else {
+                int* value = nullptr;
+                for (const auto& flag : flags_) {
+                    if (flag.first == argv[i])
+                        value = flag.second;
+                }
+                if (!value)
+                    return Usage(argv[0]);
+                *value = atoi(argv[++i]);
+            }
+        }
+        return true;
+    }
+
+    bool Selected(const std::string& name) const
+    {
+        return !filter || name.find(filter) != std::string::npos;
+    }
+
+    const char* filter = nullptr;
+    const char* out_path = nullptr;
+    double min_time_ms;
+
+private:
+    bool Usage(const char* program) const
+    {
+        fprintf(stderr, "usage: %s", program);
+        for (const auto& flag : flags_)
+            fprintf(stderr, " [%s <n>]", flag.first.c_str());
+        fprintf(stderr, " [--filter <substring>] [--min-time-ms <ms>] [--out <file>]\n");
+        return false;
+    }
+
+    std::vector<std::pair<std::string, int*>> flags_;
+};
+
+struct Timing {
+    unsigned long iterations;
+    double ns_per_op;
+};
+
+// Calls run(iterations), which performs that many ops, growing the
+// iteration count until a call takes long enough to time reliably
+template <typename Run>
+Timing Measure(double min_time_ms, Run run)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    unsigned long iterations = 1;
+    while (true) {
+        Clock::time_point start = Clock::now();
+        run(iterations);
+        double elapsed_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+        if (elapsed_ns >= min_time_ms * 1e6 || iterations >= (1UL << 30))
+            return {iterations, elapsed_ns / iterations};
+        iterations *= 2;
+    }
+}
+
+// One JSON document: the parameters of the run, then a "benchmarks" list
+// with name, iterations, ns_per_op and the metrics of every result
+class Report {
+public:
+    Report() = default;
+    ~Report()
+    {
+        if (out_ && out_ != stdout)
+            fclose(out_);
+    }
+
+    // Writes to path, stdout if it is null
+    bool Open(const char* path)
+    {
+        out_ = path ? fopen(path, "w") : stdout;
+        if (!out_) {
+            perror(path);
+            return false;
+        }
+        fprintf(out_, "{\n");
+        return true;
+    }
+
+    // Only before the first result
+    void AddParameter(const char* name, long value)
+    {
+        fprintf(out_, "  \"%s\": %ld,\n", name, value);
+    }
+
+    void AddResult(const std::string& name, const Timing& timing)
+    {
+        fprintf(out_, "%s    {\"name\": \"%s\", \"iterations\": %lu, \"ns_per_op\": %.1f",
+                results_ ? "},\n" : "  \"benchmarks\": [\n", name.c_str(), timing.iterations,
+                timing.ns_per_op);
+        results_++;
+    }
+
+    // Extra field of the last result
+    void AddMetric(const char* name, double value, int precision)
+    {
+        fprintf(out_, ", \"%s\": %.*f", name, precision, value);
+    }
+
+    void Finish()
+    {
+        fprintf(out_, "%s  ]\n}\n", results_ ? "}\n" : "  \"benchmarks\": [\n");
+    }
+
+private:
+    FILE* out_ = nullptr;
+    int results_ = 0;
+
+    Report(const Report&) = delete;
+    Report& operator=(const Report&) = delete;
+};
+
+}  // namespace harness
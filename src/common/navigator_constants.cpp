@@ -6,7 +6,19 @@ const char JSONGroupName[] = "laboratorios-5min-18m";
 const char JSONUserName[] = "navigator";
 const char JSONLocation[] = "CTI";
 const char FinderURL[] = "http://200.126.23.138:8003/track";
-const char BluescanStringDelimeter[] = ",";
 const int MaxScanBeacons = 20;
+// Bonus in dB for beacons already reported in the previous window
+const int BeaconHysteresisDb = 3;
+// Send the Eddystone UID instead of the MAC as beacon identifier
+const bool IdentifyBeaconsByUid = true;
+const RssiStatistic ReportedRssiStatistic = RssiStatistic::kMedian;
+// Fingerprint store of JSONGroupName for on-device localisation, see
+// fingerprint_store.h. Without it every fix is asked to FinderURL.
+const char FingerprintDatabasePath[] = "/data/misc/navigator/fingerprints.bin";
+// Fingerprints voting for the location of a scan
+const int LocalizerNeighbours = 3;
+// Scans labelled in learning mode, until they are compiled into
+// FingerprintDatabasePath
+const char LearnLogPath[] = "/data/misc/navigator/learn.log";
 
 }  // namespace navigator
\ No newline at end of file
@@ -2,11 +2,24 @@
 
 namespace navigator {
 
+// Per-beacon statistic sent to the localisation server as "rssi"
+enum class RssiStatistic {
+    kMean,
+    kMedian,
+    kMax,
+    kEwma,
+};
+
 extern const char JSONGroupName[];
 extern const char JSONUserName[];
 extern const char JSONLocation[];
 extern const char FinderURL[];
-extern const char BluescanStringDelimeter[];
 extern const int MaxScanBeacons;
+extern const int BeaconHysteresisDb;
+extern const bool IdentifyBeaconsByUid;
+extern const RssiStatistic ReportedRssiStatistic;
+extern const char FingerprintDatabasePath[];
+extern const int LocalizerNeighbours;
+extern const char LearnLogPath[];
 
 }  // namespace navigator
\ No newline at end of file
@@ -20,6 +20,10 @@ LOCAL_INIT_RC := navigator.rc
 LOCAL_REQUIRED_MODULES := navigator.json
 
 LOCAL_SRC_FILES := \
+	fingerprint_store.cpp \
+	knn_kernel.cpp \
+	learn_log.cpp \
+	localizer.cpp \
 	navigator.cpp \
 
 LOCAL_SHARED_LIBRARIES := \
@@ -37,6 +41,8 @@ LOCAL_STATIC_LIBRARIES := \
 	libservices-common \
 
 LOCAL_CFLAGS := -Wall -Werror
+# Silvermont (Edison) has SSE4.2 but no AVX, see knn_kernel.h
+LOCAL_CFLAGS_x86 := -msse4.1
 LOCAL_CLANG := true
 
 include $(BUILD_EXECUTABLE)
@@ -49,3 +55,41 @@ LOCAL_MODULE_CLASS := ETC
 LOCAL_MODULE_PATH := $(TARGET_OUT_ETC)/weaved/traits
 LOCAL_SRC_FILES := etc/weaved/traits/$(LOCAL_MODULE)
 include $(BUILD_PREBUILT)
+
+# Fingerprint store converter, run on the build host
+# ========================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := fingerprint_convert
+LOCAL_MODULE_TAGS := optional
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/../common \
+	$(LOCAL_PATH)/../bluescan \
+
+LOCAL_SRC_FILES := \
+	tools/fingerprint_convert.cpp \
+	fingerprint_store.cpp \
+	../bluescan/eddystone.cpp \
+	../common/beacon_address.cpp \
+	../common/navigator_constants.cpp \
+
+LOCAL_SHARED_LIBRARIES := libchrome
+LOCAL_CLANG := true
+LOCAL_CFLAGS := -Wall -Werror
+
+include $(BUILD_HOST_EXECUTABLE)
+
+# Fingerprint matching benchmark, run on the build host
+# ========================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := knn_bench
+LOCAL_MODULE_TAGS := optional
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../common
+
+LOCAL_SRC_FILES := \
+	bench/knn_bench.cpp \
+	knn_kernel.cpp \
+
+LOCAL_CLANG := true
+LOCAL_CFLAGS := -Wall -O2 -msse4.1
+
+include $(BUILD_HOST_EXECUTABLE)
@@ -0,0 +1,163 @@
+// Cost of matching one scan against 1k, 10k and 100k fingerprints with
+// the nearest-neighbour kernels, run on the build host.
+//
+// Usage: knn_bench [--beacons <n>] [--k <n>] [--filter <substring>]
+//                  [--min-time-ms <ms>] [--out <file>]
+//
+// Each op is one scan matched against every fingerprint of a synthetic
+// store: num_beacons columns, each fingerprint hearing about a third of
+// the beacons. The SSE4.1 kernel is checked against the scalar one before
+// it is timed. Prints one JSON document with ns/op and ns per fingerprint.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "bench_harness.h"
+#include "knn_kernel.h"
+
+using navigator::DistanceMetric;
+using navigator::Neighbour;
+
+namespace {
+
+const size_t kSizes[] = {1000, 10000, 100000};
+const int8_t kMissing = -128;
+
+struct Matrix {
+    size_t num_beacons;
+    size_t num_fingerprints;
+    size_t stride;
+    std::vector<int8_t> data;
+};
+
+unsigned int Next(unsigned int* seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return *seed >> 8;
+}
+
+Matrix MakeMatrix(size_t num_beacons, size_t num_fingerprints)
+{
+    Matrix matrix;
+    matrix.num_beacons = num_beacons;
+    matrix.num_fingerprints = num_fingerprints;
+    matrix.stride = (num_fingerprints + 15) & ~static_cast<size_t>(15);
+    matrix.data.assign(num_beacons * matrix.stride, kMissing);
+
+    unsigned int seed = 1;
+    for (size_t b = 0; b < num_beacons; b++) {
+        for (size_t f = 0; f < num_fingerprints; f++) {
+            if (Next(&seed) % 3 == 0)
+                matrix.data[b * matrix.stride + f] = -40 - static_cast<int>(Next(&seed) % 60);
+        }
+    }
+    return matrix;
+}
+
+std::vector<int8_t> MakeQuery(size_t num_beacons)
+{
+    std::vector<int8_t> query(num_beacons, kMissing);
+    unsigned int seed = 7;
+    for (size_t b = 0; b < num_beacons; b++) {
+        if (Next(&seed) % 3 == 0)
+            query[b] = -40 - static_cast<int>(Next(&seed) % 60);
+    }
+    return query;
+}
+
+typedef void (*Kernel)(const int8_t*, const int8_t*, size_t, size_t, size_t,
+                       DistanceMetric, size_t, std::vector<Neighbour>*);
+
+struct Bench {
+    std::string name;
+    Kernel kernel;
+    DistanceMetric metric;
+};
+
+harness::Timing Run(const Bench& bench, const Matrix& matrix, const std::vector<int8_t>& query,
+                    size_t k, double min_time_ms)
+{
+    std::vector<Neighbour> nearest;
+    return harness::Measure(min_time_ms, [&](unsigned long iterations) {
+        for (unsigned long i = 0; i < iterations; i++)
+            bench.kernel(query.data(), matrix.data.data(), matrix.num_beacons,
+                         matrix.num_fingerprints, matrix.stride, bench.metric, k, &nearest);
+    });
+}
+
+bool SameNeighbours(const std::vector<Neighbour>& a, const std::vector<Neighbour>& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].distance != b[i].distance || a[i].fingerprint != b[i].fingerprint)
+            return false;
+    }
+    return true;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+    harness::Options options(200);
+    int beacons = 48;
+    int k = 3;
+    options.AddFlag("--beacons", &beacons);
+    options.AddFlag("--k", &k);
+    if (!options.Parse(argc, argv))
+        return EXIT_FAILURE;
+    if (beacons <= 0 || k <= 0) {
+        fprintf(stderr, "--beacons and --k must be positive\n");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Bench> benches;
+    benches.push_back({"scalar/l1", navigator::NearestFingerprintsScalar, DistanceMetric::kL1});
+    benches.push_back({"scalar/l2", navigator::NearestFingerprintsScalar, DistanceMetric::kL2});
+#if defined(__SSE4_1__)
+    benches.push_back({"sse41/l1", navigator::NearestFingerprintsSse41, DistanceMetric::kL1});
+    benches.push_back({"sse41/l2", navigator::NearestFingerprintsSse41, DistanceMetric::kL2});
+#endif
+
+    harness::Report report;
+    if (!report.Open(options.out_path))
+        return EXIT_FAILURE;
+    report.AddParameter("beacons", beacons);
+    report.AddParameter("k", k);
+
+    std::vector<int8_t> query = MakeQuery(beacons);
+    for (size_t fingerprints : kSizes) {
+        Matrix matrix = MakeMatrix(beacons, fingerprints);
+
+        std::vector<Neighbour> expected[2];
+        for (int metric = 0; metric < 2; metric++)
+            navigator::NearestFingerprintsScalar(query.data(), matrix.data.data(), matrix.num_beacons,
+                                                 matrix.num_fingerprints, matrix.stride,
+                                                 metric ? DistanceMetric::kL2 : DistanceMetric::kL1,
+                                                 k, &expected[metric]);
+
+        for (const Bench& bench : benches) {
+            std::string name = bench.name + "/" + std::to_string(fingerprints);
+            if (!options.Selected(name))
+                continue;
+
+            std::vector<Neighbour> nearest;
+            bench.kernel(query.data(), matrix.data.data(), matrix.num_beacons, matrix.num_fingerprints,
+                         matrix.stride, bench.metric, k, &nearest);
+            if (!SameNeighbours(nearest, expected[bench.metric == DistanceMetric::kL2])) {
+                fprintf(stderr, "%s disagrees with the scalar kernel\n", name.c_str());
+                return EXIT_FAILURE;
+            }
+
+            harness::Timing timing = Run(bench, matrix, query, k, options.min_time_ms);
+            report.AddResult(name, timing);
+            report.AddMetric("ns_per_fingerprint", timing.ns_per_op / fingerprints, 3);
+        }
+    }
+    report.Finish();
+    return EXIT_SUCCESS;
+}
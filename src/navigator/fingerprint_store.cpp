@@ -0,0 +1,249 @@
+#include "fingerprint_store.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace navigator {
+
+namespace {
+uint64_t Align(uint64_t offset)
+{
+    return (offset + kStoreAlignment - 1) & ~static_cast<uint64_t>(kStoreAlignment - 1);
+}
+
+// Whether count items of item_size fit at offset, which must be aligned
+bool SectionFits(uint64_t offset, uint64_t count, uint64_t item_size, uint64_t size)
+{
+    return offset % kStoreAlignment == 0 && offset <= size && count * item_size <= size - offset;
+}
+
+int8_t QuantizeRssi(int rssi)
+{
+    return static_cast<int8_t>(std::max(kStoreMissingRssi + 1, std::min(rssi, 0)));
+}
+
+bool WriteAll(int fd, const char* data, size_t size)
+{
+    while (size) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0)
+            return false;
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+}  // anonymous namespace
+
+FingerprintStore::~FingerprintStore()
+{
+    Close();
+}
+
+bool FingerprintStore::Open(const std::string& path)
+{
+    Close();
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < static_cast<off_t>(sizeof(FingerprintStoreHeader))) {
+        close(fd);
+        return false;
+    }
+
+    size_ = st.st_size;
+    data_ = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data_ == MAP_FAILED) {
+        data_ = nullptr;
+        return false;
+    }
+
+    const char* base = static_cast<const char*>(data_);
+    const FingerprintStoreHeader* header = reinterpret_cast<const FingerprintStoreHeader*>(base);
+    uint64_t size = size_;
+    if (memcmp(header->magic, kStoreMagic, sizeof(kStoreMagic)) || header->version != kStoreVersion ||
+        header->file_size != size_ || !memchr(header->group, '\0', sizeof(header->group)) ||
+        header->num_locations > UINT16_MAX + 1u ||
+        header->column_stride < header->num_fingerprints || header->column_stride % kStoreAlignment ||
+        !SectionFits(header->beacons_offset, header->num_beacons, sizeof(uint64_t), size) ||
+        !SectionFits(header->locations_offset, header->num_fingerprints, sizeof(uint16_t), size) ||
+        !SectionFits(header->name_offsets_offset, header->num_locations + 1ull, sizeof(uint32_t), size) ||
+        !SectionFits(header->names_offset, 0, 1, size) ||
+        !SectionFits(header->matrix_offset, static_cast<uint64_t>(header->num_beacons) * header->column_stride, 1, size)) {
+        Close();
+        return false;
+    }
+
+    beacons_ = reinterpret_cast<const uint64_t*>(base + header->beacons_offset);
+    locations_ = reinterpret_cast<const uint16_t*>(base + header->locations_offset);
+    name_offsets_ = reinterpret_cast<const uint32_t*>(base + header->name_offsets_offset);
+    names_ = base + header->names_offset;
+    matrix_ = reinterpret_cast<const int8_t*>(base + header->matrix_offset);
+
+    // Cheap checks that keep lookups inside the mapping
+    uint64_t names_size = size - header->names_offset;
+    for (uint32_t i = 0; i < header->num_locations; i++) {
+        uint32_t offset = name_offsets_[i];
+        if (offset >= names_size || !memchr(names_ + offset, '\0', names_size - offset)) {
+            Close();
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header->num_fingerprints; i++) {
+        if (locations_[i] >= header->num_locations) {
+            Close();
+            return false;
+        }
+    }
+    for (uint32_t i = 1; i < header->num_beacons; i++) {
+        if (beacons_[i - 1] >= beacons_[i]) {
+            Close();
+            return false;
+        }
+    }
+
+    header_ = header;
+    return true;
+}
+
+void FingerprintStore::Close()
+{
+    if (data_)
+        munmap(data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+    header_ = nullptr;
+    beacons_ = nullptr;
+    locations_ = nullptr;
+    name_offsets_ = nullptr;
+    names_ = nullptr;
+    matrix_ = nullptr;
+}
+
+int FingerprintStore::FindBeacon(uint64_t key) const
+{
+    const uint64_t* end = beacons_ + num_beacons();
+    const uint64_t* it = std::lower_bound(beacons_, end, key);
+    if (it == end || *it != key)
+        return -1;
+    return it - beacons_;
+}
+
+void FingerprintStore::ReadFingerprints(std::vector<Fingerprint>* fingerprints) const
+{
+    for (size_t f = 0; f < num_fingerprints(); f++) {
+        Fingerprint fingerprint;
+        fingerprint.location = location_name(location_of(f));
+        for (size_t b = 0; b < num_beacons(); b++) {
+            int8_t rssi = column(b)[f];
+            if (rssi != kStoreMissingRssi)
+                fingerprint.readings.push_back(std::make_pair(beacon(b), rssi));
+        }
+        fingerprints->push_back(fingerprint);
+    }
+}
+
+bool WriteFingerprintStore(const std::string& path, const std::string& group,
+                           const std::vector<Fingerprint>& fingerprints)
+{
+    FingerprintStoreHeader header;
+    memset(&header, 0, sizeof(header));
+    if (group.size() >= sizeof(header.group))
+        return false;
+
+    std::vector<uint64_t> beacons;
+    for (const Fingerprint& fingerprint : fingerprints) {
+        for (const auto& reading : fingerprint.readings)
+            beacons.push_back(reading.first);
+    }
+    std::sort(beacons.begin(), beacons.end());
+    beacons.erase(std::unique(beacons.begin(), beacons.end()), beacons.end());
+
+    std::vector<std::string> names;
+    std::vector<uint16_t> locations;
+    for (const Fingerprint& fingerprint : fingerprints) {
+        auto it = std::find(names.begin(), names.end(), fingerprint.location);
+        if (it == names.end()) {
+            if (names.size() > UINT16_MAX)
+                return false;
+            it = names.insert(names.end(), fingerprint.location);
+        }
+        locations.push_back(it - names.begin());
+    }
+
+    std::vector<uint32_t> name_offsets;
+    std::string name_block;
+    for (const std::string& name : names) {
+        name_offsets.push_back(name_block.size());
+        name_block.append(name.c_str(), name.size() + 1);
+    }
+    name_offsets.push_back(name_block.size());
+
+    uint64_t stride = Align(fingerprints.size());
+    uint64_t beacons_offset = Align(sizeof(header));
+    uint64_t locations_offset = Align(beacons_offset + beacons.size() * sizeof(uint64_t));
+    uint64_t name_offsets_offset = Align(locations_offset + locations.size() * sizeof(uint16_t));
+    uint64_t names_offset = Align(name_offsets_offset + name_offsets.size() * sizeof(uint32_t));
+    uint64_t matrix_offset = Align(names_offset + name_block.size());
+    uint64_t file_size = matrix_offset + beacons.size() * stride;
+    if (file_size > UINT32_MAX)
+        return false;
+
+    memcpy(header.magic, kStoreMagic, sizeof(header.magic));
+    header.version = kStoreVersion;
+    memcpy(header.group, group.c_str(), group.size());
+    header.num_beacons = beacons.size();
+    header.num_fingerprints = fingerprints.size();
+    header.num_locations = names.size();
+    header.column_stride = stride;
+    header.beacons_offset = beacons_offset;
+    header.locations_offset = locations_offset;
+    header.name_offsets_offset = name_offsets_offset;
+    header.names_offset = names_offset;
+    header.matrix_offset = matrix_offset;
+    header.file_size = file_size;
+
+    std::vector<char> data(file_size, 0);
+    memcpy(&data[0], &header, sizeof(header));
+    if (!beacons.empty())
+        memcpy(&data[beacons_offset], beacons.data(), beacons.size() * sizeof(uint64_t));
+    if (!locations.empty())
+        memcpy(&data[locations_offset], locations.data(), locations.size() * sizeof(uint16_t));
+    memcpy(&data[name_offsets_offset], name_offsets.data(), name_offsets.size() * sizeof(uint32_t));
+    if (!name_block.empty())
+        memcpy(&data[names_offset], name_block.data(), name_block.size());
+
+    int8_t* matrix = reinterpret_cast<int8_t*>(&data[0] + matrix_offset);
+    memset(matrix, kStoreMissingRssi, beacons.size() * stride);
+    for (size_t i = 0; i < fingerprints.size(); i++) {
+        for (const auto& reading : fingerprints[i].readings) {
+            size_t column = std::lower_bound(beacons.begin(), beacons.end(), reading.first) - beacons.begin();
+            matrix[column * stride + i] = QuantizeRssi(reading.second);
+        }
+    }
+
+    // Write aside and rename, readers keep the old file mapped
+    std::string temp = path + ".tmp";
+    int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+    bool ok = WriteAll(fd, data.data(), data.size()) && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(temp.c_str(), path.c_str()) < 0) {
+        unlink(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+}  // namespace navigator
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace navigator {
+
+// Binary fingerprint database, mapped read-only so opening it costs no
+// parsing and no allocation. All integers are little-endian, every
+// section starts at a multiple of 16 bytes:
+//
+//   header       FingerprintStoreHeader
+//   beacons      uint64_t[num_beacons], ascending beacon keys (see
+//                BeaconKey in navigator.cpp); a beacon's index is its column
+//   locations    uint16_t[num_fingerprints], location of every fingerprint
+//   name offsets uint32_t[num_locations + 1], into the name block
+//   names        location names, NUL-terminated
+//   matrix       int8_t[num_beacons][column_stride], one column per beacon
+//                holding the RSSI of every fingerprint, so matching walks
+//                memory linearly. kStoreMissingRssi marks fingerprints
+//                without the beacon and the padding up to column_stride.
+struct FingerprintStoreHeader {
+    char magic[4];
+    uint32_t version;
+    char group[64];
+    uint32_t num_beacons;
+    uint32_t num_fingerprints;
+    uint32_t num_locations;
+    uint32_t column_stride;
+    uint32_t beacons_offset;
+    uint32_t locations_offset;
+    uint32_t name_offsets_offset;
+    uint32_t names_offset;
+    uint32_t matrix_offset;
+    uint32_t file_size;
+};
+
+const char kStoreMagic[4] = {'N', 'V', 'F', 'P'};
+const uint32_t kStoreVersion = 1;
+// Alignment of the sections and of column_stride
+const size_t kStoreAlignment = 16;
+const int8_t kStoreMissingRssi = -128;
+
+// One fingerprint of a store: beacon key and RSSI pairs
+struct Fingerprint {
+    std::string location;
+    std::vector<std::pair<uint64_t, int>> readings;
+};
+
+class FingerprintStore {
+public:
+    FingerprintStore() = default;
+    ~FingerprintStore();
+
+    // Maps path, false if it cannot be read or is not a valid store
+    bool Open(const std::string& path);
+    void Close();
+    bool is_open() const { return header_ != nullptr; }
+
+    const char* group() const { return header_->group; }
+    size_t num_beacons() const { return header_->num_beacons; }
+    size_t num_fingerprints() const { return header_->num_fingerprints; }
+    size_t num_locations() const { return header_->num_locations; }
+    size_t column_stride() const { return header_->column_stride; }
+
+    // Column of a beacon, -1 if the store does not know it
+    int FindBeacon(uint64_t key) const;
+    uint64_t beacon(size_t column) const { return beacons_[column]; }
+    const int8_t* column(size_t column) const { return matrix_ + column * column_stride(); }
+
+    size_t location_of(size_t fingerprint) const { return locations_[fingerprint]; }
+    const char* location_name(size_t location) const { return names_ + name_offsets_[location]; }
+
+    // Unpacks every fingerprint, e.g. to write them again with new ones
+    void ReadFingerprints(std::vector<Fingerprint>* fingerprints) const;
+
+private:
+    void* data_ = nullptr;
+    size_t size_ = 0;
+
+    const FingerprintStoreHeader* header_ = nullptr;
+    const uint64_t* beacons_ = nullptr;
+    const uint16_t* locations_ = nullptr;
+    const uint32_t* name_offsets_ = nullptr;
+    const char* names_ = nullptr;
+    const int8_t* matrix_ = nullptr;
+
+    FingerprintStore(const FingerprintStore&) = delete;
+    FingerprintStore& operator=(const FingerprintStore&) = delete;
+};
+
+// Writes fingerprints as a store. The file is replaced atomically, so a
+// store mapped from path stays valid until it is reopened.
+bool WriteFingerprintStore(const std::string& path, const std::string& group,
+                           const std::vector<Fingerprint>& fingerprints);
+
+}  // namespace navigator
@@ -0,0 +1,186 @@
+#include "knn_kernel.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+
+#include "fingerprint_store.h"
+
+namespace navigator {
+
+namespace {
+
+// Fingerprints handled per pass over the beacon columns, one SSE register
+const size_t kBlock = 16;
+
+int8_t Present(int8_t rssi)
+{
+    return rssi == kStoreMissingRssi ? kAbsentRssi : rssi;
+}
+
+// Keeps the k smallest distances offered, in ascending fingerprint order
+class TopK {
+public:
+    TopK(size_t k, std::vector<Neighbour>* nearest)
+        : k_(k), nearest_(nearest)
+    {
+        nearest_->clear();
+        nearest_->reserve(k + 1);
+    }
+
+    void Offer(uint32_t distance, uint32_t fingerprint)
+    {
+        if (nearest_->size() == k_ && (!k_ || distance >= nearest_->back().distance))
+            return;
+
+        // After equal distances, which came from lower fingerprints
+        auto it = std::upper_bound(nearest_->begin(), nearest_->end(), distance,
+                                   [](uint32_t d, const Neighbour& n) { return d < n.distance; });
+        nearest_->insert(it, {distance, fingerprint});
+        if (nearest_->size() > k_)
+            nearest_->pop_back();
+    }
+
+private:
+    size_t k_;
+    std::vector<Neighbour>* nearest_;
+};
+
+template <DistanceMetric metric>
+void ScalarKernel(const int8_t* query, const int8_t* matrix,
+                  size_t num_beacons, size_t num_fingerprints, size_t column_stride,
+                  size_t k, std::vector<Neighbour>* nearest)
+{
+    TopK top(k, nearest);
+    for (size_t f0 = 0; f0 < num_fingerprints; f0 += kBlock) {
+        uint32_t distances[kBlock] = {};
+        for (size_t b = 0; b < num_beacons; b++) {
+            int q = Present(query[b]);
+            const int8_t* column = matrix + b * column_stride + f0;
+            for (size_t j = 0; j < kBlock; j++) {
+                int d = q - Present(column[j]);
+                distances[j] += metric == DistanceMetric::kL1 ? abs(d) : d * d;
+            }
+        }
+
+        size_t n = std::min(kBlock, num_fingerprints - f0);
+        for (size_t j = 0; j < n; j++)
+            top.Offer(distances[j], f0 + j);
+    }
+}
+
+#if defined(__SSE4_1__)
+// Columns of |d| that fit the 16-bit partial sums, 512 * 127 < 65536
+const size_t kWideFlush = 512;
+
+// Adds eight unsigned 16-bit lanes of fingerprints 0-7 and 8-15 to the
+// 32-bit distances
+inline void Widen(__m128i lo, __m128i hi, __m128i* acc0, __m128i* acc1, __m128i* acc2, __m128i* acc3)
+{
+    *acc0 = _mm_add_epi32(*acc0, _mm_cvtepu16_epi32(lo));
+    *acc1 = _mm_add_epi32(*acc1, _mm_cvtepu16_epi32(_mm_srli_si128(lo, 8)));
+    *acc2 = _mm_add_epi32(*acc2, _mm_cvtepu16_epi32(hi));
+    *acc3 = _mm_add_epi32(*acc3, _mm_cvtepu16_epi32(_mm_srli_si128(hi, 8)));
+}
+
+template <DistanceMetric metric>
+void Sse41Kernel(const int8_t* query, const int8_t* matrix,
+                 size_t num_beacons, size_t num_fingerprints, size_t column_stride,
+                 size_t k, std::vector<Neighbour>* nearest)
+{
+    const __m128i missing = _mm_set1_epi8(kStoreMissingRssi);
+    const __m128i absent = _mm_set1_epi8(kAbsentRssi);
+
+    TopK top(k, nearest);
+    for (size_t f0 = 0; f0 < num_fingerprints; f0 += kBlock) {
+        // Four lanes of 32-bit distances per register, fingerprints f0..f0+15
+        __m128i acc0 = _mm_setzero_si128();
+        __m128i acc1 = _mm_setzero_si128();
+        __m128i acc2 = _mm_setzero_si128();
+        __m128i acc3 = _mm_setzero_si128();
+
+        // L1 sums |d| <= 127 in 16-bit lanes for up to kWideFlush columns
+        // before widening; L2 squares need the 32-bit lanes right away
+        __m128i sum_lo = _mm_setzero_si128();
+        __m128i sum_hi = _mm_setzero_si128();
+        size_t pending = 0;
+
+        for (size_t b = 0; b < num_beacons; b++) {
+            __m128i q = _mm_set1_epi8(Present(query[b]));
+            __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(matrix + b * column_stride + f0));
+            r = _mm_blendv_epi8(r, absent, _mm_cmpeq_epi8(r, missing));
+
+            // Both sides lie in [-127, 0], the difference cannot overflow
+            __m128i d = _mm_abs_epi8(_mm_sub_epi8(q, r));
+            __m128i lo = _mm_cvtepu8_epi16(d);
+            __m128i hi = _mm_cvtepu8_epi16(_mm_srli_si128(d, 8));
+
+            if (metric == DistanceMetric::kL1) {
+                sum_lo = _mm_add_epi16(sum_lo, lo);
+                sum_hi = _mm_add_epi16(sum_hi, hi);
+                if (++pending == kWideFlush) {
+                    Widen(sum_lo, sum_hi, &acc0, &acc1, &acc2, &acc3);
+                    sum_lo = sum_hi = _mm_setzero_si128();
+                    pending = 0;
+                }
+            } else {
+                // 127^2 still fits an unsigned 16-bit lane
+                Widen(_mm_mullo_epi16(lo, lo), _mm_mullo_epi16(hi, hi), &acc0, &acc1, &acc2, &acc3);
+            }
+        }
+        if (pending)
+            Widen(sum_lo, sum_hi, &acc0, &acc1, &acc2, &acc3);
+
+        uint32_t distances[kBlock];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(distances), acc0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(distances + 4), acc1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(distances + 8), acc2);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(distances + 12), acc3);
+
+        size_t n = std::min(kBlock, num_fingerprints - f0);
+        for (size_t j = 0; j < n; j++)
+            top.Offer(distances[j], f0 + j);
+    }
+}
+#endif
+
+}  // anonymous namespace
+
+void NearestFingerprintsScalar(const int8_t* query, const int8_t* matrix,
+                               size_t num_beacons, size_t num_fingerprints, size_t column_stride,
+                               DistanceMetric metric, size_t k, std::vector<Neighbour>* nearest)
+{
+    if (metric == DistanceMetric::kL1)
+        ScalarKernel<DistanceMetric::kL1>(query, matrix, num_beacons, num_fingerprints, column_stride, k, nearest);
+    else
+        ScalarKernel<DistanceMetric::kL2>(query, matrix, num_beacons, num_fingerprints, column_stride, k, nearest);
+}
+
+#if defined(__SSE4_1__)
+void NearestFingerprintsSse41(const int8_t* query, const int8_t* matrix,
+                              size_t num_beacons, size_t num_fingerprints, size_t column_stride,
+                              DistanceMetric metric, size_t k, std::vector<Neighbour>* nearest)
+{
+    if (metric == DistanceMetric::kL1)
+        Sse41Kernel<DistanceMetric::kL1>(query, matrix, num_beacons, num_fingerprints, column_stride, k, nearest);
+    else
+        Sse41Kernel<DistanceMetric::kL2>(query, matrix, num_beacons, num_fingerprints, column_stride, k, nearest);
+}
+#endif
+
+void NearestFingerprints(const int8_t* query, const int8_t* matrix,
+                         size_t num_beacons, size_t num_fingerprints, size_t column_stride,
+                         DistanceMetric metric, size_t k, std::vector<Neighbour>* nearest)
+{
+#if defined(__SSE4_1__)
+    NearestFingerprintsSse41(query, matrix, num_beacons, num_fingerprints, column_stride, metric, k, nearest);
+#else
+    NearestFingerprintsScalar(query, matrix, num_beacons, num_fingerprints, column_stride, metric, k, nearest);
+#endif
+}
+
+}  // namespace navigator
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace navigator {
+
+enum class DistanceMetric {
+    kL1,
+    kL2,
+};
+
+struct Neighbour {
+    uint32_t distance;
+    uint32_t fingerprint;
+};
+
+// RSSI an absent beacon counts as, on either side of a comparison. A
+// beacon missing from both the scan and a fingerprint adds nothing.
+const int8_t kAbsentRssi = -100;
+
+// Distances between query (one RSSI per beacon, kStoreMissingRssi when
+// absent) and every fingerprint of a column-major matrix as laid out in a
+// FingerprintStore: num_beacons columns of column_stride bytes, where
+// column_stride is a multiple of 16 and the padding holds
+// kStoreMissingRssi. The k nearest fingerprints are returned in nearest,
+// closest first, ties by fingerprint index.
+void NearestFingerprints(const int8_t* query, const int8_t* matrix,
+                         size_t num_beacons, size_t num_fingerprints, size_t column_stride,
+                         DistanceMetric metric, size_t k, std::vector<Neighbour>* nearest);
+
+// The implementations behind NearestFingerprints, for benchmarks. The
+// SSE4.1 one only exists in builds targeting it; Silvermont (Edison) has
+// SSE4.2 but no AVX.
+void NearestFingerprintsScalar(const int8_t* query, const int8_t* matrix,
+                               size_t num_beacons, size_t num_fingerprints, size_t column_stride,
+                               DistanceMetric metric, size_t k, std::vector<Neighbour>* nearest);
+#if defined(__SSE4_1__)
+void NearestFingerprintsSse41(const int8_t* query, const int8_t* matrix,
+                              size_t num_beacons, size_t num_fingerprints, size_t column_stride,
+                              DistanceMetric metric, size_t k, std::vector<Neighbour>* nearest);
+#endif
+
+}  // namespace navigator
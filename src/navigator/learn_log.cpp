@@ -0,0 +1,196 @@
+#include "learn_log.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <base/logging.h>
+
+namespace navigator {
+
+namespace {
+bool ReadAll(int fd, std::string* data)
+{
+    char buffer[4096];
+    ssize_t size;
+    while ((size = read(fd, buffer, sizeof(buffer))) > 0)
+        data->append(buffer, size);
+    return size == 0;
+}
+
+// Walks the records of data, adding them to fingerprints if not null.
+// end is where the complete records stop; whatever follows is a torn
+// record if this returns true, and corrupt if it returns false.
+bool ParseRecords(const std::string& data, std::vector<Fingerprint>* fingerprints, size_t* end)
+{
+    size_t offset = 0;
+    while (data.size() - offset >= sizeof(LearnRecordHeader)) {
+        LearnRecordHeader header;
+        memcpy(&header, data.data() + offset, sizeof(header));
+        if (memcmp(header.magic, kLearnRecordMagic, sizeof(header.magic))) {
+            *end = offset;
+            return false;
+        }
+
+        size_t record_size = sizeof(header) + header.location_size +
+                             header.num_readings * (sizeof(uint64_t) + 1);
+        if (data.size() - offset < record_size)
+            break;
+
+        const char* location = data.data() + offset + sizeof(header);
+        const char* keys = location + header.location_size;
+        const int8_t* rssis = reinterpret_cast<const int8_t*>(keys + header.num_readings * sizeof(uint64_t));
+
+        Fingerprint fingerprint;
+        fingerprint.location.assign(location, header.location_size);
+        for (size_t i = 0; i < header.num_readings; i++) {
+            // Append clamps to [-127, 0], anything else is not a record
+            if (rssis[i] > 0 || rssis[i] == kStoreMissingRssi) {
+                *end = offset;
+                return false;
+            }
+            uint64_t key;
+            memcpy(&key, keys + i * sizeof(key), sizeof(key));
+            fingerprint.readings.push_back(std::make_pair(key, rssis[i]));
+        }
+        if (fingerprints)
+            fingerprints->push_back(fingerprint);
+        offset += record_size;
+    }
+
+    *end = offset;
+    return true;
+}
+}  // anonymous namespace
+
+LearnLog::LearnLog(const std::string& path)
+    : path_(path)
+{
+}
+
+bool LearnLog::Append(const std::string& location, const std::vector<BeaconReading>& scan)
+{
+    if (location.size() > UINT16_MAX || scan.size() > UINT16_MAX)
+        return false;
+
+    LearnRecordHeader header;
+    memcpy(header.magic, kLearnRecordMagic, sizeof(header.magic));
+    header.location_size = location.size();
+    header.num_readings = scan.size();
+
+    std::string record(reinterpret_cast<const char*>(&header), sizeof(header));
+    record += location;
+    for (const BeaconReading& reading : scan)
+        record.append(reinterpret_cast<const char*>(&reading.key), sizeof(reading.key));
+    for (const BeaconReading& reading : scan)
+        record += static_cast<char>(std::max(kStoreMissingRssi + 1, std::min(reading.rssi, 0)));
+
+    int fd = open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0640);
+    if (fd < 0)
+        return false;
+
+    // A log that is not as long as this instance left it may end in a
+    // record torn by a crash, which must go before anything is appended
+    // behind it
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return false;
+    }
+    if (st.st_size != end_) {
+        std::string data;
+        size_t end;
+        if (!ReadAll(fd, &data)) {
+            close(fd);
+            return false;
+        }
+        if (!ParseRecords(data, nullptr, &end)) {
+            LOG(ERROR) << "Corrupt learn log record at " << end << " in " << path_ << ", not appending";
+            close(fd);
+            return false;
+        }
+        if (end != data.size()) {
+            LOG(WARNING) << "Dropping " << data.size() - end << " bytes of a torn record in " << path_;
+            if (ftruncate(fd, end) < 0) {
+                close(fd);
+                return false;
+            }
+        }
+        end_ = end;
+    }
+
+    // One write per record, a short one is cut off again right away
+    ssize_t written = pwrite(fd, record.data(), record.size(), end_);
+    bool ok = written == static_cast<ssize_t>(record.size());
+    if (ok)
+        end_ += record.size();
+    else if (written > 0 && ftruncate(fd, end_) < 0)
+        end_ = -1;
+    ok = close(fd) == 0 && ok;
+    return ok;
+}
+
+bool LearnLog::Read(std::vector<Fingerprint>* fingerprints) const
+{
+    int fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return errno == ENOENT;
+
+    std::string data;
+    bool ok = ReadAll(fd, &data);
+    close(fd);
+    if (!ok)
+        return false;
+
+    size_t end;
+    if (!ParseRecords(data, fingerprints, &end)) {
+        LOG(ERROR) << "Corrupt learn log record at " << end << " in " << path_;
+        return false;
+    }
+    if (end != data.size())
+        LOG(WARNING) << "Ignoring " << data.size() - end << " bytes of a torn record in " << path_;
+    return true;
+}
+
+bool LearnLog::Clear()
+{
+    end_ = -1;
+    return unlink(path_.c_str()) == 0 || errno == ENOENT;
+}
+
+bool CompileLearnLog(LearnLog* log, const std::string& store_path,
+                     const std::string& group, size_t* added)
+{
+    std::vector<Fingerprint> fingerprints;
+    struct stat st;
+    if (stat(store_path.c_str(), &st) == 0) {
+        FingerprintStore store;
+        if (!store.Open(store_path)) {
+            LOG(ERROR) << "Not merging into invalid fingerprint store " << store_path;
+            return false;
+        }
+        if (group != store.group()) {
+            LOG(ERROR) << "Not merging into fingerprint store of group " << store.group();
+            return false;
+        }
+        store.ReadFingerprints(&fingerprints);
+    }
+
+    // A log that does not parse is kept, nothing of it is merged
+    size_t existing = fingerprints.size();
+    if (!log->Read(&fingerprints))
+        return false;
+    *added = fingerprints.size() - existing;
+    if (!*added)
+        return true;
+
+    if (!WriteFingerprintStore(store_path, group, fingerprints))
+        return false;
+    return log->Clear();
+}
+
+}  // namespace navigator
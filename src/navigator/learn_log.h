@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <string>
+#include <vector>
+
+#include "fingerprint_store.h"
+#include "localizer.h"
+
+namespace navigator {
+
+// Record of one labelled scan in the learn log, followed by location_size
+// bytes of location name, num_readings uint64 beacon keys and
+// num_readings int8 RSSIs
+struct LearnRecordHeader {
+    char magic[4];
+    uint16_t location_size;
+    uint16_t num_readings;
+};
+
+const char kLearnRecordMagic[4] = {'N', 'V', 'L', 'R'};
+
+// Append-only log of the scans taken in learning mode. Every record is
+// written with a single write, so a crash can only cut the last one.
+// Read ignores a torn last record and Append cuts it off before writing
+// behind it.
+class LearnLog {
+public:
+    explicit LearnLog(const std::string& path);
+
+    bool Append(const std::string& location, const std::vector<BeaconReading>& scan);
+
+    // Adds the logged scans as fingerprints, false if the log cannot be
+    // read or is corrupt before its last record. A missing log holds no
+    // scans.
+    bool Read(std::vector<Fingerprint>* fingerprints) const;
+
+    // Forgets the logged scans
+    bool Clear();
+
+private:
+    std::string path_;
+    // Size of the log after the last Append, -1 before the first one
+    off_t end_ = -1;
+};
+
+// Merges the scans of the log into the store of group at store_path and
+// clears the log. Nothing changes if the log does not parse, or if the
+// store exists but cannot be read or is of another group. added is the
+// number of new fingerprints.
+bool CompileLearnLog(LearnLog* log, const std::string& store_path,
+                     const std::string& group, size_t* added);
+
+}  // namespace navigator
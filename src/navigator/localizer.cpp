@@ -0,0 +1,88 @@
+#include "localizer.h"
+
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <base/logging.h>
+
+#include "knn_kernel.h"
+#include "navigator_constants.h"
+
+namespace navigator {
+
+Localizer::Localizer(const std::string& path)
+    : path_(path)
+{
+}
+
+bool Localizer::Refresh()
+{
+    struct stat st;
+    if (stat(path_.c_str(), &st) < 0) {
+        if (store_.is_open())
+            LOG(INFO) << "Fingerprint store removed";
+        mtime_ = 0;
+        inode_ = 0;
+        store_.Close();
+        return false;
+    }
+
+    // New stores are renamed into place, so a new inode means a new store
+    if (st.st_mtime == mtime_ && st.st_ino == inode_)
+        return store_.is_open();
+
+    mtime_ = st.st_mtime;
+    inode_ = st.st_ino;
+    if (!store_.Open(path_)) {
+        LOG(ERROR) << "Invalid fingerprint store " << path_;
+        return false;
+    }
+    if (strcmp(store_.group(), JSONGroupName)) {
+        LOG(ERROR) << "Fingerprint store is for group " << store_.group();
+        store_.Close();
+        return false;
+    }
+
+    LOG(INFO) << "Fingerprint store loaded: " << store_.num_fingerprints() << " fingerprints, "
+              << store_.num_locations() << " locations, " << store_.num_beacons() << " beacons";
+    return true;
+}
+
+bool Localizer::Locate(const std::vector<BeaconReading>& scan, std::string* location) const
+{
+    if (!store_.is_open() || !store_.num_fingerprints())
+        return false;
+
+    // Beacons the store does not know add the same distance to every
+    // fingerprint and are left out
+    std::vector<int8_t> query(store_.num_beacons(), kStoreMissingRssi);
+    size_t common = 0;
+    for (const BeaconReading& reading : scan) {
+        int column = store_.FindBeacon(reading.key);
+        if (column >= 0) {
+            query[column] = std::max(kStoreMissingRssi + 1, std::min(reading.rssi, 0));
+            common++;
+        }
+    }
+    if (!common)
+        return false;
+
+    std::vector<Neighbour> nearest;
+    NearestFingerprints(query.data(), store_.column(0), store_.num_beacons(),
+                        store_.num_fingerprints(), store_.column_stride(),
+                        DistanceMetric::kL2, LocalizerNeighbours, &nearest);
+
+    // Neighbours vote for their location, closer ones weigh more
+    std::vector<double> votes(store_.num_locations(), 0.0);
+    for (const Neighbour& neighbour : nearest)
+        votes[store_.location_of(neighbour.fingerprint)] += 1.0 / (1.0 + std::sqrt(neighbour.distance));
+
+    size_t best = std::max_element(votes.begin(), votes.end()) - votes.begin();
+    *location = store_.location_name(best);
+    return true;
+}
+
+}  // namespace navigator
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#include "fingerprint_store.h"
+
+namespace navigator {
+
+// One beacon of a scan, keyed by BeaconKey in navigator.cpp
+struct BeaconReading {
+    uint64_t key;
+    int rssi;
+};
+
+// On-device k-nearest-neighbour matching of scans against the
+// fingerprint store of JSONGroupName, so a fix does not need a round trip
+// to the server. Stores are built from the server's JSON fingerprints by
+// the fingerprint_convert host tool.
+class Localizer {
+public:
+    explicit Localizer(const std::string& path);
+
+    // (Re)maps the store if the file was replaced since the last call.
+    // Returns whether a store is open.
+    bool Refresh();
+
+    // Location of the scan, false if there is no store or the scan shares
+    // no beacon with it
+    bool Locate(const std::vector<BeaconReading>& scan, std::string* location) const;
+
+private:
+    std::string path_;
+    time_t mtime_ = 0;
+    ino_t inode_ = 0;
+
+    FingerprintStore store_;
+};
+
+}  // namespace navigator
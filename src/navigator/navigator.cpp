@@ -1,3 +1,5 @@
+#include <cmath>
+#include <map>
 #include <string>
 #include <vector>
 #include <sysexits.h>
@@ -8,7 +10,6 @@
 #include <base/memory/weak_ptr.h>
 #include <base/json/json_writer.h>
 #include <base/values.h>
-#include <base/strings/string_split.h>
 #include <binderwrapper/binder_wrapper.h>
 #include <brillo/binder_watcher.h>
 #include <brillo/daemons/daemon.h>
@@ -19,6 +20,9 @@
 
 #include "binder_constants.h"
 #include "navigator_constants.h"
+#include "beacon_sample.h"
+#include "learn_log.h"
+#include "localizer.h"
 #include "navigator/services/screen/IScreenService.h"
 #include "navigator/services/bluescan/IBluescanService.h"
 #include "navigator/services/bluescan/BnBluescanCallback.h"
@@ -28,11 +32,86 @@ using android::String16;
 using navigator::services::screen::IScreenService;
 using navigator::services::bluescan::IBluescanService;
 using navigator::services::bluescan::BnBluescanCallback;
+using navigator::services::bluescan::BeaconSample;
+using navigator::services::bluescan::FormatAddress;
 
 
 namespace {
 const char kBaseComponent[] = "base";
 const char kBaseTrait[] = "base";
+const char kLearnComponent[] = "learn";
+const char kLearnTrait[] = "_learn";
+
+// Readings older than this are aged out of the continuous scan window.
+// bluescan also delivers a snapshot every window, so this is the period
+// of the position fixes.
+const int kScanWindowMs = 3500;
+
+// Position requests waiting for the server at once. Snapshots arriving
+// while this many are pending are skipped.
+const size_t kMaxRequestsInFlight = 2;
+
+// Length of the scan the identify command runs next to localisation
+const int kIdentifyScanMs = 2000;
+
+std::string HexString(const uint8_t* data, size_t size)
+{
+    static const char kDigits[] = "0123456789abcdef";
+    std::string hex;
+    for (size_t i = 0; i < size; i++) {
+        hex += kDigits[data[i] >> 4];
+        hex += kDigits[data[i] & 0xf];
+    }
+    return hex;
+}
+
+// Identifier sent to the server as "mac": the Eddystone UID when known,
+// since beacons may rotate addresses, the address otherwise. With
+// IdentifyBeaconsByUid off every beacon is sent by its address.
+std::string BeaconId(const BeaconSample& sample)
+{
+    if (navigator::IdentifyBeaconsByUid && sample.has_uid)
+        return HexString(sample.uid, sizeof(sample.uid));
+    return FormatAddress(sample.last_address);
+}
+
+// Key of the beacon matched on-device and learned, the one
+// fingerprint_convert derives from BeaconId
+uint64_t BeaconKey(const BeaconSample& sample)
+{
+    return navigator::IdentifyBeaconsByUid ? sample.address : sample.last_address;
+}
+
+// RSSI of a beacon as sent to the server and matched on-device
+int ReportedRssi(const BeaconSample& sample)
+{
+    switch (navigator::ReportedRssiStatistic) {
+    case navigator::RssiStatistic::kMean:   return std::lround(sample.mean);
+    case navigator::RssiStatistic::kMedian: return sample.median;
+    case navigator::RssiStatistic::kMax:    return sample.max;
+    case navigator::RssiStatistic::kEwma:   return std::lround(sample.ewma);
+    }
+    return sample.median;
+}
+
+// Results of the identify scan, which runs in its own bluescan session so
+// it does not disturb localisation. They are only logged.
+class IdentifyScanCallback : public BnBluescanCallback {
+public:
+    android::binder::Status OnFinishScanCallback(const std::vector<BeaconSample>& scanResults) override
+    {
+        LOG(INFO) << "Identify: " << scanResults.size() << " beacons in range";
+        for (const BeaconSample& sample : scanResults)
+            LOG(INFO) << "  " << BeaconId(sample) << " rssi " << static_cast<int>(sample.median)
+                      << " count " << sample.count;
+        return android::binder::Status::ok();
+    }
+
+    android::binder::Status OnScanBatch(const std::vector<BeaconSample>& /*samples*/) override
+    {
+        return android::binder::Status::ok();
+    }
+};
 }  // anonymous namespace
 
 class Daemon final : public brillo::Daemon, public BnBluescanCallback {
@@ -41,9 +120,11 @@ public:
 
 protected:
     int OnInit() override;
-    android::binder::Status OnFinishScanCallback(const std::vector<String16>& scanResults);
-    void SendHTTPRequest(std::string scanJSON);
+    android::binder::Status OnFinishScanCallback(const std::vector<BeaconSample>& scanResults);
+    android::binder::Status OnScanBatch(const std::vector<BeaconSample>& samples);
+    void SendHTTPRequest(const std::string& scanJSON);
     void FindPosition();
+    void ShowLocation(const std::string& location);
 
 private:
     void OnWeaveServiceConnected(const std::weak_ptr<weaved::Service>& service);
@@ -52,13 +133,20 @@ private:
     void ConnectToBluescanService();
     void OnBluescanServiceDisconnected();
     void OnPairingInfoChanged(const weaved::Service::PairingInfo* pairing_info);
-    void JSONfy(const std::vector<String16>& scanResults, std::string& output_js);
+    void JSONfy(const std::vector<BeaconSample>& scanResults, std::string& output_js);
     void HTTP_Success_callback(brillo::http::RequestID id, std::unique_ptr<brillo::http::Response> response);
     void HTTP_Error_callback(brillo::http::RequestID id, const brillo::Error* error);
+    // Sequence number of a completed request, or 0 if it was overtaken by
+    // a newer one and its result must be dropped
+    int TakeRequest(brillo::http::RequestID id);
 
     // Particular command handlers for various commands.
     void OnSetConfig(std::unique_ptr<weaved::Command> command);
     void OnIdentify(std::unique_ptr<weaved::Command> command);
+    void OnLearnStart(std::unique_ptr<weaved::Command> command);
+    void OnLearnStop(std::unique_ptr<weaved::Command> command);
+    void OnLearnCompile(std::unique_ptr<weaved::Command> command);
+    void UpdateLearnState();
 
     std::weak_ptr<weaved::Service> weave_service_;
 
@@ -67,11 +155,34 @@ private:
     
     // Bluescan service interface.
     android::sp<IBluescanService> bluescan_service_;
+    // Bluescan sessions for localisation and for the identify command
+    int scan_session_ = 0;
+    int identify_session_ = 0;
+    android::sp<IdentifyScanCallback> identify_callback_{new IdentifyScanCallback()};
 
     brillo::BinderWatcher binder_watcher_;
     std::unique_ptr<weaved::Service::Subscription> weave_service_subscription_;
     std::shared_ptr<brillo::http::Transport> transport_;
 
+    // On-device localisation, the server is only asked when it cannot
+    // place a scan
+    navigator::Localizer localizer_{navigator::FingerprintDatabasePath};
+
+    // Learning mode: snapshots are logged as fingerprints of
+    // learn_location_ instead of being located, and compiled into the
+    // fingerprint store on request
+    navigator::LearnLog learn_log_{navigator::LearnLogPath};
+    bool learning_ = false;
+    std::string learn_location_;
+    int learn_scans_ = 0;
+
+    // Pipelined position requests: sequence number of every request in
+    // flight, and of the newest position shown. Local fixes take a
+    // sequence number too.
+    std::map<brillo::http::RequestID, int> requests_;
+    int next_sequence_ = 1;
+    int shown_sequence_ = 0;
+
     base::WeakPtrFactory<Daemon> weak_ptr_factory_{this};
     DISALLOW_COPY_AND_ASSIGN(Daemon);
 };
@@ -112,6 +223,18 @@ void Daemon::OnWeaveServiceConnected(
       kBaseComponent, kBaseTrait, "identify",
       base::Bind(&Daemon::OnIdentify, weak_ptr_factory_.GetWeakPtr()));
 
+    weave_service->AddComponent(kLearnComponent, {kLearnTrait}, nullptr);
+    weave_service->AddCommandHandler(
+      kLearnComponent, kLearnTrait, "start",
+      base::Bind(&Daemon::OnLearnStart, weak_ptr_factory_.GetWeakPtr()));
+    weave_service->AddCommandHandler(
+      kLearnComponent, kLearnTrait, "stop",
+      base::Bind(&Daemon::OnLearnStop, weak_ptr_factory_.GetWeakPtr()));
+    weave_service->AddCommandHandler(
+      kLearnComponent, kLearnTrait, "compile",
+      base::Bind(&Daemon::OnLearnCompile, weak_ptr_factory_.GetWeakPtr()));
+    UpdateLearnState();
+
     weave_service->SetPairingInfoListener(
       base::Bind(&Daemon::OnPairingInfoChanged,
                  weak_ptr_factory_.GetWeakPtr()));
@@ -150,7 +273,13 @@ void Daemon::ConnectToBluescanService() {
                  weak_ptr_factory_.GetWeakPtr()));
     bluescan_service_ = android::interface_cast<IBluescanService>(binder);
 
-    bluescan_service_->RegisterCallback(this);
+    bluescan_service_->RegisterCallback(this, &scan_session_);
+    bluescan_service_->RegisterCallback(identify_callback_, &identify_session_);
+
+    // Only Eddystone beacons are fingerprinted, let the controller drop
+    // everything else
+    bluescan_service_->ConfigureScan(IBluescanService::SCAN_MODE_BALANCED, 0, true,
+                                     std::vector<String16>(), std::vector<int8_t>());
     
     brillo::MessageLoop::current()->PostDelayedTask(
             base::Bind(&Daemon::FindPosition,
@@ -170,7 +299,21 @@ void Daemon::OnBluescanServiceDisconnected() {
 
 void Daemon::FindPosition()
 {
-    bluescan_service_->DoScan(3500);
+    if (!bluescan_service_.get())
+        return;
+
+    // The radio scans continuously and bluescan delivers a snapshot every
+    // window, each one is sent to the server while the next window is
+    // being collected. If the scan cannot start yet (bluetooth still
+    // coming up) try again later.
+    android::binder::Status status =
+        bluescan_service_->StartContinuousScan(scan_session_, kScanWindowMs, kScanWindowMs);
+    if (!status.isOk()) {
+        brillo::MessageLoop::current()->PostDelayedTask(
+            base::Bind(&Daemon::FindPosition,
+                       weak_ptr_factory_.GetWeakPtr()),
+            base::TimeDelta::FromSeconds(1));
+    }
 }
 
 void Daemon::OnSetConfig(std::unique_ptr<weaved::Command> command) {
@@ -210,7 +353,7 @@ void Daemon::OnIdentify(std::unique_ptr<weaved::Command> command) {
 
     android::binder::Status status1 = screen_service_->DisplayText(String16("Here"), 20, 10);
     
-    android::binder::Status status2 = bluescan_service_->DoScan(3000);
+    android::binder::Status status2 = bluescan_service_->DoScan(identify_session_, kIdentifyScanMs);
 
     if (!status1.isOk() || !status2.isOk()) {
         command->AbortWithCustomError(status2, nullptr);
@@ -220,14 +363,103 @@ void Daemon::OnIdentify(std::unique_ptr<weaved::Command> command) {
     command->Complete({}, nullptr);
 }
 
+void Daemon::OnLearnStart(std::unique_ptr<weaved::Command> command)
+{
+    std::string location = command->GetParameter<std::string>("location");
+    if (location.empty())
+        location = navigator::JSONLocation;
+
+    learning_ = true;
+    learn_location_ = location;
+    learn_scans_ = 0;
+    LOG(INFO) << "Learning location " << learn_location_;
+    if (screen_service_.get())
+        screen_service_->DisplayCenteredText(String16(("Learn " + learn_location_).c_str()));
+
+    UpdateLearnState();
+    command->Complete({}, nullptr);
+}
+
+void Daemon::OnLearnStop(std::unique_ptr<weaved::Command> command)
+{
+    if (learning_)
+        LOG(INFO) << "Learned " << learn_scans_ << " scans of " << learn_location_;
+    learning_ = false;
+
+    UpdateLearnState();
+    command->Complete({}, nullptr);
+}
+
+void Daemon::OnLearnCompile(std::unique_ptr<weaved::Command> command)
+{
+    // All the scans logged so far go into the store in one go; the
+    // localizer picks the new store up on the next snapshot
+    size_t added = 0;
+    if (!navigator::CompileLearnLog(&learn_log_, navigator::FingerprintDatabasePath,
+                                    navigator::JSONGroupName, &added)) {
+        command->Abort("_compile_failed", "cannot update the fingerprint store", nullptr);
+        return;
+    }
+    LOG(INFO) << "Compiled " << added << " learned fingerprints";
+
+    base::DictionaryValue results;
+    results.SetInteger("fingerprints", added);
+    command->Complete(results, nullptr);
+}
+
+void Daemon::UpdateLearnState()
+{
+    auto weave_service = weave_service_.lock();
+    if (!weave_service)
+        return;
+
+    base::DictionaryValue state;
+    state.SetBoolean("_learn.learning", learning_);
+    state.SetString("_learn.location", learn_location_);
+    state.SetInteger("_learn.scans", learn_scans_);
+    weave_service->SetStateProperties(kLearnComponent, state, nullptr);
+}
 
 void Daemon::OnPairingInfoChanged(
     const weaved::Service::PairingInfo* pairing_info) {
     LOG(INFO) << "Daemon::OnPairingInfoChanged: " << pairing_info;
 }
 
-android::binder::Status Daemon::OnFinishScanCallback(const std::vector<String16>& scanResults){
+android::binder::Status Daemon::OnFinishScanCallback(const std::vector<BeaconSample>& scanResults){
         
+        std::vector<navigator::BeaconReading> scan;
+        for (const BeaconSample& sample : scanResults)
+            scan.push_back({BeaconKey(sample), ReportedRssi(sample)});
+
+        if (learning_) {
+            if (scan.empty())
+                return android::binder::Status::ok();
+            if (!learn_log_.Append(learn_location_, scan)) {
+                LOG(ERROR) << "Cannot log scan to " << navigator::LearnLogPath;
+                return android::binder::Status::ok();
+            }
+            learn_scans_++;
+            UpdateLearnState();
+            return android::binder::Status::ok();
+        }
+
+        if (localizer_.Refresh()) {
+            std::string location;
+            if (localizer_.Locate(scan, &location)) {
+                // Newer than every request in flight, whose replies are
+                // now dropped by TakeRequest
+                shown_sequence_ = next_sequence_++;
+                ShowLocation(location);
+                return android::binder::Status::ok();
+            }
+            LOG(INFO) << "No local fix, asking the server";
+        }
+
+        if (requests_.size() >= kMaxRequestsInFlight) {
+            LOG(WARNING) << "Server busy, skipping scan window";
+            return android::binder::Status::ok();
+        }
+
         std::string results_json("{}");
         
         JSONfy(scanResults, results_json);
@@ -240,15 +472,48 @@ android::binder::Status Daemon::OnFinishScanCallback(const std::vector<String16>
         return android::binder::Status::ok();
 }
 
-void Daemon::SendHTTPRequest(std::string scanJSON)
+android::binder::Status Daemon::OnScanBatch(const std::vector<BeaconSample>& samples){
+        // Positions come from continuous-scan snapshots; streaming batches
+        // are just traced.
+        VLOG(1) << "Scan batch: " << samples.size() << " samples";
+        return android::binder::Status::ok();
+}
+
+void Daemon::SendHTTPRequest(const std::string& scanJSON)
 {
-    brillo::http::PostText(navigator::FinderURL, scanJSON, brillo::mime::application::kJson, {}, transport_, 
+    brillo::http::RequestID id = brillo::http::PostText(navigator::FinderURL, scanJSON, brillo::mime::application::kJson, {}, transport_, 
     base::Bind(&Daemon::HTTP_Success_callback, weak_ptr_factory_.GetWeakPtr()),base::Bind(&Daemon::HTTP_Error_callback, weak_ptr_factory_.GetWeakPtr()));
     
-    LOG(INFO) << "Watinting for response...";
+    requests_[id] = next_sequence_++;
+    LOG(INFO) << "Watinting for response (" << requests_.size() << " in flight)...";
+}
+
+int Daemon::TakeRequest(brillo::http::RequestID id)
+{
+    auto it = requests_.find(id);
+    if (it == requests_.end())
+        return 0;
+
+    int sequence = it->second;
+    requests_.erase(it);
+    if (sequence < shown_sequence_) {
+        LOG(INFO) << "Dropping stale response of request " << id;
+        return 0;
+    }
+    shown_sequence_ = sequence;
+    return sequence;
+}
+
+void Daemon::ShowLocation(const std::string& location)
+{
+    LOG(INFO) << "Location: " << location;
+    screen_service_->DisplayCenteredText(String16(location.c_str()));
 }
 
-void Daemon::HTTP_Success_callback(brillo::http::RequestID /*id*/, std::unique_ptr<brillo::http::Response> response) {
+void Daemon::HTTP_Success_callback(brillo::http::RequestID id, std::unique_ptr<brillo::http::Response> response) {
+    if (!TakeRequest(id))
+        return;
+
     int statusCode;
     std::unique_ptr<base::DictionaryValue> jsonResponse;
     
@@ -260,8 +525,7 @@ void Daemon::HTTP_Success_callback(brillo::http::RequestID /*id*/, std::unique_p
             std::string value("??");
             if(jsonResponse->HasKey("location")){
                 jsonResponse->GetString("location",&value);
-                LOG(INFO) << "Location: " << value;
-                screen_service_->DisplayCenteredText(String16(value.c_str()));
+                ShowLocation(value);
             }else{
                 LOG(ERROR) << "UNKNOWN LOCATION";
                 screen_service_->TagPositionLost();
@@ -270,25 +534,17 @@ void Daemon::HTTP_Success_callback(brillo::http::RequestID /*id*/, std::unique_p
             LOG(ERROR) << "No JSON response";
     }else
         LOG(ERROR) << "Response code: " << statusCode;
-        
-    brillo::MessageLoop::current()->PostDelayedTask(
-            base::Bind(&Daemon::FindPosition,
-                       weak_ptr_factory_.GetWeakPtr()),
-            base::TimeDelta::FromSeconds(1));
-    
 }
     
 void Daemon::HTTP_Error_callback(brillo::http::RequestID id, const brillo::Error* error) {
     LOG(ERROR) << "Request id: "<< id << " ERROR MSG: " << error->GetMessage();
+    if (!TakeRequest(id))
+        return;
+
     screen_service_->TagPositionLost();
-    
-    brillo::MessageLoop::current()->PostDelayedTask(
-            base::Bind(&Daemon::FindPosition,
-                       weak_ptr_factory_.GetWeakPtr()),
-            base::TimeDelta::FromSeconds(1));
 }
 
-void Daemon::JSONfy(const std::vector<String16>& scanResults, std::string& output_js)
+void Daemon::JSONfy(const std::vector<BeaconSample>& scanResults, std::string& output_js)
 {
     int n = scanResults.size();
     
@@ -301,14 +557,24 @@ void Daemon::JSONfy(const std::vector<String16>& scanResults, std::string& outpu
     scoped_ptr<base::ListValue> list(new base::ListValue());
     for(int i=0;i<n;i++)
     {
-        std::string s = android::String8(scanResults[i]).string();
-        std::vector<std::string> tokens = base::SplitString(s,navigator::BluescanStringDelimeter,base::KEEP_WHITESPACE, base::SPLIT_WANT_ALL);
-        std::string mac = tokens[0];
-        int rssi = std::stoi(tokens[1]);
-        
+        const BeaconSample& sample = scanResults[i];
+
         scoped_ptr<base::DictionaryValue> inner_dict(new base::DictionaryValue());
-        inner_dict->SetString("mac", std::move(mac));
-        inner_dict->SetInteger("rssi", rssi);
+        inner_dict->SetString("mac", BeaconId(sample));
+        inner_dict->SetInteger("rssi", ReportedRssi(sample));
+        inner_dict->SetInteger("count", sample.count);
+        inner_dict->SetDouble("mean", sample.mean);
+        inner_dict->SetInteger("median", sample.median);
+        inner_dict->SetInteger("min", sample.min);
+        inner_dict->SetInteger("max", sample.max);
+        inner_dict->SetDouble("variance", sample.variance);
+        inner_dict->SetDouble("ewma", sample.ewma);
+        if (sample.has_tx_power)
+            inner_dict->SetDouble("distance", sample.distance);
+        if (sample.has_telemetry) {
+            inner_dict->SetInteger("battery", sample.battery_mv);
+            inner_dict->SetDouble("temperature", sample.temperature);
+        }
         list->Append(std::move(inner_dict));
     }
     
@@ -0,0 +1,191 @@
+// Builds a fingerprint store for on-device localisation from fingerprints
+// in the JSON format of the FIND server, run on the build host.
+//
+// Usage: fingerprint_convert [--group <name>] <input.json> <output.bin>
+//
+// The input holds fingerprints like the ones the navigator posts:
+//
+//   {"group": "...", "location": "...",
+//    "wifi-fingerprint": [{"mac": "...", "rssi": -70}, ...]}
+//
+// either as one JSON array, as {"fingerprints": [...]}, or one per line.
+// Only fingerprints of the group (JSONGroupName by default) are kept.
+// "mac" is an address or a 32-digit Eddystone UID, as sent by the
+// navigator. Push the output to the device as
+// /data/misc/navigator/fingerprints.bin.
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <base/files/file_path.h>
+#include <base/files/file_util.h>
+#include <base/json/json_reader.h>
+#include <base/values.h>
+
+#include "beacon_address.h"
+#include "eddystone.h"
+#include "fingerprint_store.h"
+#include "navigator_constants.h"
+
+using navigator::Fingerprint;
+using navigator::services::bluescan::ParseAddress;
+
+namespace {
+
+bool ParseHex(const std::string& text, uint8_t* bytes, size_t size)
+{
+    if (text.size() != 2 * size)
+        return false;
+    for (size_t i = 0; i < size; i++) {
+        unsigned value;
+        if (sscanf(text.c_str() + 2 * i, "%2x", &value) != 1 ||
+            !isxdigit(text[2 * i]) || !isxdigit(text[2 * i + 1]))
+            return false;
+        bytes[i] = value;
+    }
+    return true;
+}
+
+// Beacon key of a "mac" field, see BeaconKey in navigator.cpp
+bool BeaconKey(const std::string& id, uint64_t* key)
+{
+    if (ParseAddress(id, key))
+        return true;
+
+    uint8_t uid[bluescan::kEddystoneNamespaceSize + bluescan::kEddystoneInstanceSize];
+    if (ParseHex(id, uid, sizeof(uid))) {
+        *key = bluescan::UidKey(uid, uid + bluescan::kEddystoneNamespaceSize);
+        return true;
+    }
+    return false;
+}
+
+struct Stats {
+    int skipped_group = 0;
+    int skipped_invalid = 0;
+    int unknown_ids = 0;
+};
+
+void AddFingerprint(const base::DictionaryValue& value, const std::string& group,
+                    std::vector<Fingerprint>* fingerprints, Stats* stats)
+{
+    std::string fingerprint_group;
+    Fingerprint fingerprint;
+    const base::ListValue* readings;
+    if (!value.GetString("location", &fingerprint.location) ||
+        !value.GetList("wifi-fingerprint", &readings)) {
+        stats->skipped_invalid++;
+        return;
+    }
+    if (value.GetString("group", &fingerprint_group) && fingerprint_group != group) {
+        stats->skipped_group++;
+        return;
+    }
+
+    for (size_t i = 0; i < readings->GetSize(); i++) {
+        const base::DictionaryValue* reading;
+        std::string id;
+        int rssi;
+        uint64_t key;
+        if (!readings->GetDictionary(i, &reading) || !reading->GetString("mac", &id) ||
+            !reading->GetInteger("rssi", &rssi))
+            continue;
+        if (!BeaconKey(id, &key)) {
+            stats->unknown_ids++;
+            continue;
+        }
+        fingerprint.readings.push_back(std::make_pair(key, rssi));
+    }
+    fingerprints->push_back(fingerprint);
+}
+
+// Adds the fingerprints of a parsed document, false if it holds none
+bool AddDocument(const base::Value& document, const std::string& group,
+                 std::vector<Fingerprint>* fingerprints, Stats* stats)
+{
+    const base::DictionaryValue* dict;
+    const base::ListValue* list;
+    if (document.GetAsDictionary(&dict)) {
+        if (!dict->GetList("fingerprints", &list)) {
+            AddFingerprint(*dict, group, fingerprints, stats);
+            return true;
+        }
+    } else if (!document.GetAsList(&list)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < list->GetSize(); i++) {
+        if (list->GetDictionary(i, &dict))
+            AddFingerprint(*dict, group, fingerprints, stats);
+        else
+            stats->skipped_invalid++;
+    }
+    return true;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+    std::string group = navigator::JSONGroupName;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--group") && i + 1 < argc)
+            group = argv[++i];
+        else
+            paths.push_back(argv[i]);
+    }
+    if (paths.size() != 2) {
+        fprintf(stderr, "usage: %s [--group <name>] <input.json> <output.bin>\n", argv[0]);
+        return 1;
+    }
+
+    std::string json;
+    if (!base::ReadFileToString(base::FilePath(paths[0]), &json)) {
+        fprintf(stderr, "cannot read %s\n", paths[0].c_str());
+        return 1;
+    }
+
+    std::vector<Fingerprint> fingerprints;
+    Stats stats;
+    scoped_ptr<base::Value> document = base::JSONReader::Read(json);
+    if (!document || !AddDocument(*document, group, &fingerprints, &stats)) {
+        // One fingerprint per line
+        std::istringstream lines(json);
+        std::string line;
+        int number = 0;
+        while (std::getline(lines, line)) {
+            number++;
+            if (line.find_first_not_of(" \t\r") == std::string::npos)
+                continue;
+            scoped_ptr<base::Value> value = base::JSONReader::Read(line);
+            if (!value || !AddDocument(*value, group, &fingerprints, &stats)) {
+                fprintf(stderr, "%s:%d: not a fingerprint\n", paths[0].c_str(), number);
+                return 1;
+            }
+        }
+    }
+
+    if (!navigator::WriteFingerprintStore(paths[1], group, fingerprints)) {
+        fprintf(stderr, "cannot write %s\n", paths[1].c_str());
+        return 1;
+    }
+
+    navigator::FingerprintStore store;
+    if (!store.Open(paths[1])) {
+        fprintf(stderr, "%s does not read back\n", paths[1].c_str());
+        return 1;
+    }
+    printf("%s: %zu fingerprints, %zu locations, %zu beacons for group %s\n",
+           paths[1].c_str(), store.num_fingerprints(), store.num_locations(),
+           store.num_beacons(), store.group());
+    if (stats.skipped_group || stats.skipped_invalid || stats.unknown_ids)
+        printf("skipped %d fingerprints of other groups, %d invalid fingerprints, %d unknown beacon ids\n",
+               stats.skipped_group, stats.skipped_invalid, stats.unknown_ids);
+    return 0;
+}
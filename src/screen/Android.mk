@@ -1,12 +1,62 @@
 LOCAL_PATH := $(call my-dir)
 
+# OLED rendering library, independent of the SPI backend
+# ========================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := libedoled
+LOCAL_EXPORT_C_INCLUDE_DIRS := $(LOCAL_PATH)/oled
+
+LOCAL_SRC_FILES := \
+	oled/Edison_OLED.cpp \
+	oled/memory_transport.cpp \
+
+LOCAL_CLANG := true
+LOCAL_CFLAGS := -Wall
+
+include $(BUILD_STATIC_LIBRARY)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := libedoled-host
+LOCAL_EXPORT_C_INCLUDE_DIRS := $(LOCAL_PATH)/oled
+
+LOCAL_SRC_FILES := \
+	oled/Edison_OLED.cpp \
+	oled/memory_transport.cpp \
+
+LOCAL_CLANG := true
+LOCAL_CFLAGS := -Wall
+
+include $(BUILD_HOST_STATIC_LIBRARY)
+
+# Rendering benchmarks, run on the build host against the memory transport
+# ========================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := oled_bench
+LOCAL_MODULE_TAGS := optional
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../common
+
+LOCAL_SRC_FILES := \
+	bench/oled_bench.cpp \
+
+LOCAL_STATIC_LIBRARIES := \
+	libedoled-host \
+
+LOCAL_CLANG := true
+LOCAL_CFLAGS := -Wall -O2
+
+include $(BUILD_HOST_EXECUTABLE)
+
+# Screen daemon
+# ========================================================
 include $(CLEAR_VARS)
 LOCAL_MODULE := screen
 LOCAL_INIT_RC := screen.rc
 
 LOCAL_SRC_FILES := \
 	screen.cpp \
-	oled/Edison_OLED.cpp \
+	draw_list.cpp \
+	text_cache.cpp \
+	oled/mraa_transport.cpp \
 
 LOCAL_SHARED_LIBRARIES := \
 	libbinder \
@@ -19,6 +69,7 @@ LOCAL_SHARED_LIBRARIES := \
 	libutils \
 
 LOCAL_STATIC_LIBRARIES := \
+	libedoled \
 	libservices-common \
 
 LOCAL_CLANG := true
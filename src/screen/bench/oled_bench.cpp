@@ -0,0 +1,153 @@
+// Rendering micro-benchmarks for edOLED, run against the in-memory transport.
+//
+// Usage: oled_bench [--filter <substring>] [--min-time-ms <ms>] [--out <file>]
+//
+// Prints one JSON document with ns/op and SPI bytes per op for every case so
+// runs of two builds can be diffed.
+
+#include <stdlib.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Edison_OLED.h"
+#include "bench_harness.h"
+#include "memory_transport.h"
+
+namespace {
+
+struct Bench {
+    std::string name;
+    // Called once before timing
+    std::function<void(edOLED&)> setup;
+    // Called with the iteration number
+    std::function<void(edOLED&, unsigned long)> op;
+};
+
+const char* const kFontNames[] = {"font5x7", "font8x16", "sevensegment", "fontlargenumber"};
+
+// Timing of bench and the SPI bytes per op of its last run
+harness::Timing Run(const Bench& bench, edOLED& oled, memoryTransport& transport, double min_time_ms,
+                  double* bytes_per_op)
+{
+    oled.setColor(WHITE);
+    oled.setDrawMode(NORM);
+    oled.setFontType(0);
+    oled.clear(PAGE);
+    oled.display();
+    if (bench.setup)
+        bench.setup(oled);
+
+    harness::Timing timing = harness::Measure(min_time_ms, [&](unsigned long iterations) {
+        transport.reset();
+        for (unsigned long i = 0; i < iterations; i++)
+            bench.op(oled, i);
+    });
+    *bytes_per_op = static_cast<double>(transport.getCommandBytes() + transport.getDataBytes()) /
+                    timing.iterations;
+    return timing;
+}
+
+std::vector<Bench> MakeBenches()
+{
+    std::vector<Bench> benches;
+
+    benches.push_back({"pixel", nullptr, [](edOLED& o, unsigned long i) {
+        o.pixel(i % LCDWIDTH, (i / LCDWIDTH) % LCDHEIGHT);
+    }});
+    benches.push_back({"line", nullptr, [](edOLED& o, unsigned long i) {
+        o.line(0, i % LCDHEIGHT, LCDWIDTH - 1, LCDHEIGHT - 1 - i % LCDHEIGHT);
+    }});
+    benches.push_back({"lineH", nullptr, [](edOLED& o, unsigned long i) {
+        o.lineH(0, i % LCDHEIGHT, LCDWIDTH);
+    }});
+    benches.push_back({"lineV", nullptr, [](edOLED& o, unsigned long i) {
+        o.lineV(i % LCDWIDTH, 0, LCDHEIGHT);
+    }});
+    benches.push_back({"rect", nullptr, [](edOLED& o, unsigned long i) {
+        o.rect(i % 8, i % 8, 40, 30);
+    }});
+    benches.push_back({"rectFill", nullptr, [](edOLED& o, unsigned long i) {
+        o.rectFill(i % 8, i % 8, 40, 30);
+    }});
+    benches.push_back({"circle", nullptr, [](edOLED& o, unsigned long i) {
+        o.circle(32, 24, 5 + i % 15);
+    }});
+    benches.push_back({"circleFill", nullptr, [](edOLED& o, unsigned long i) {
+        o.circleFill(32, 24, 5 + i % 15);
+    }});
+
+    // drawChar on page aligned and unaligned rows, next to the per-pixel reference
+    for (unsigned char font = 0; font < 4; font++) {
+        for (int aligned = 1; aligned >= 0; aligned--) {
+            unsigned char y = aligned ? 8 : 11;
+            std::string suffix = std::string(kFontNames[font]) + (aligned ? "/aligned" : "/unaligned");
+            auto setup = [font](edOLED& o) { o.setFontType(font); };
+            benches.push_back({"drawChar/" + suffix, setup, [y](edOLED& o, unsigned long i) {
+                o.drawChar(i % 16, y, o.getFontStartChar() + i % o.getFontTotalChar(), WHITE, NORM);
+            }});
+            benches.push_back({"drawCharPixel/" + suffix, setup, [y](edOLED& o, unsigned long i) {
+                o.drawCharPixel(i % 16, y, o.getFontStartChar() + i % o.getFontTotalChar(), WHITE, NORM);
+            }});
+        }
+    }
+
+    benches.push_back({"print", nullptr, [](edOLED& o, unsigned long) {
+        o.setCursor(2, 25);
+        o.print("LAB 5 CTI");
+    }});
+    benches.push_back({"clear(PAGE)", nullptr, [](edOLED& o, unsigned long) {
+        o.clear(PAGE);
+    }});
+
+    // display() cost depends on how much of the frame changed since the last one
+    benches.push_back({"display/unchanged", nullptr, [](edOLED& o, unsigned long) {
+        o.display();
+    }});
+    benches.push_back({"display/text_line", nullptr, [](edOLED& o, unsigned long i) {
+        o.setCursor(2, 25);
+        o.print(i % 2 ? "LAB 5" : "CTI 1");
+        o.display();
+    }});
+    benches.push_back({"display/position_lost", nullptr, [](edOLED& o, unsigned long i) {
+        o.circleFill(59, 6, 3, i % 2 ? WHITE : BLACK, NORM);
+        o.display();
+    }});
+    benches.push_back({"display/full_frame", nullptr, [](edOLED& o, unsigned long) {
+        o.rectFill(0, 0, LCDWIDTH, LCDHEIGHT, WHITE, XOR);
+        o.display();
+    }});
+
+    return benches;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+    harness::Options options(100);
+    if (!options.Parse(argc, argv))
+        return EXIT_FAILURE;
+
+    memoryTransport transport;
+    transport.setRecording(false);
+    edOLED oled(&transport);
+    oled.begin();
+
+    harness::Report report;
+    if (!report.Open(options.out_path))
+        return EXIT_FAILURE;
+
+    for (const Bench& bench : MakeBenches()) {
+        if (!options.Selected(bench.name))
+            continue;
+
+        double bytes_per_op;
+        harness::Timing timing = Run(bench, oled, transport, options.min_time_ms, &bytes_per_op);
+        report.AddResult(bench.name, timing);
+        report.AddMetric("bytes_per_op", bytes_per_op, 2);
+    }
+    report.Finish();
+    return EXIT_SUCCESS;
+}
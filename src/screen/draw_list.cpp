@@ -0,0 +1,184 @@
+#include "draw_list.h"
+#include "text_cache.h"
+
+namespace screen {
+
+namespace {
+
+// Number of arguments that follow an op code, -1 for ops not allowed in a list
+int ArgCount(int32_t op)
+{
+    switch (op) {
+    case CMD_SETCOLOR:
+    case CMD_SETDRAWMODE:
+    case CMD_SETFONT:
+    case CMD_PRINT:
+        return 1;
+    case CMD_SETCURSOR:
+    case CMD_PIXEL:
+    case CMD_PRINTCENTERED:
+        return 2;
+    case CMD_LINEH:
+    case CMD_LINEV:
+    case CMD_CIRCLE:
+    case CMD_CIRCLEFILL:
+    case CMD_DRAWCHAR:
+        return 3;
+    case CMD_CLEAR:
+    case CMD_LINE:
+    case CMD_RECT:
+    case CMD_RECTFILL:
+        return 4;
+    case CMD_DRAWBITMAP:
+        return 5;
+    default:
+        return -1;
+    }
+}
+
+}  // anonymous namespace
+
+bool DrawList::Validate(std::string* error) const
+{
+    size_t i = 0;
+    while (i < ops.size()) {
+        int32_t op = ops[i];
+        int argc = ArgCount(op);
+        if (argc < 0) {
+            *error = "unsupported op code " + std::to_string(op);
+            return false;
+        }
+        if (i + 1 + argc > ops.size()) {
+            *error = "missing arguments for op code " + std::to_string(op);
+            return false;
+        }
+
+        const int32_t* args = &ops[i + 1];
+        // The last argument of text and bitmap ops is a reference, the rest are coordinates
+        int coords = (op == CMD_PRINT || op == CMD_PRINTCENTERED || op == CMD_DRAWBITMAP) ? argc - 1 : argc;
+        for (int j = 0; j < coords; j++) {
+            if (args[j] < 0 || args[j] > 255) {
+                *error = "argument out of range for op code " + std::to_string(op);
+                return false;
+            }
+        }
+
+        if (op == CMD_PRINT || op == CMD_PRINTCENTERED) {
+            int32_t text = args[argc - 1];
+            if (text < 0 || static_cast<size_t>(text) >= texts.size()) {
+                *error = "bad text index " + std::to_string(text);
+                return false;
+            }
+        } else if (op == CMD_DRAWBITMAP) {
+            int32_t offset = args[4];
+            size_t size = static_cast<size_t>((args[3] + 7) / 8) * args[2];
+            if (offset < 0 || static_cast<size_t>(offset) + size > bitmaps.size()) {
+                *error = "bad bitmap offset " + std::to_string(offset);
+                return false;
+            }
+        }
+        i += 1 + argc;
+    }
+    return true;
+}
+
+bool DrawList::ClearsScreen() const
+{
+    return ops.size() >= 5 && ops[0] == CMD_CLEAR &&
+           ops[1] == 0 && ops[2] == 0 && ops[3] >= LCDWIDTH && ops[4] >= LCDHEIGHT;
+}
+
+void DrawList::Apply(edOLED& oled, TextCache* cache) const
+{
+    // edOLED keeps these private, they are tracked here for drawBitmap()
+    unsigned char color = WHITE;
+    unsigned char mode = NORM;
+
+    oled.setColor(color);
+    oled.setDrawMode(mode);
+    oled.setFontType(0);
+    oled.setCursor(0, 0);
+
+    size_t i = 0;
+    while (i < ops.size()) {
+        const int32_t* a = &ops[i + 1];
+        switch (ops[i]) {
+        case CMD_CLEAR:
+            if (a[0] == 0 && a[1] == 0 && a[2] >= LCDWIDTH && a[3] >= LCDHEIGHT)
+                oled.clear(PAGE);
+            else
+                oled.rectFill(a[0], a[1], a[2], a[3], BLACK, NORM);
+            break;
+        case CMD_SETCURSOR:
+            oled.setCursor(a[0], a[1]);
+            break;
+        case CMD_PIXEL:
+            oled.pixel(a[0], a[1]);
+            break;
+        case CMD_LINE:
+            oled.line(a[0], a[1], a[2], a[3]);
+            break;
+        case CMD_LINEH:
+            oled.lineH(a[0], a[1], a[2]);
+            break;
+        case CMD_LINEV:
+            oled.lineV(a[0], a[1], a[2]);
+            break;
+        case CMD_RECT:
+            oled.rect(a[0], a[1], a[2], a[3]);
+            break;
+        case CMD_RECTFILL:
+            oled.rectFill(a[0], a[1], a[2], a[3]);
+            break;
+        case CMD_CIRCLE:
+            oled.circle(a[0], a[1], a[2]);
+            break;
+        case CMD_CIRCLEFILL:
+            oled.circleFill(a[0], a[1], a[2]);
+            break;
+        case CMD_DRAWCHAR:
+            oled.drawChar(a[0], a[1], a[2]);
+            break;
+        case CMD_SETCOLOR:
+            color = a[0];
+            oled.setColor(color);
+            break;
+        case CMD_SETDRAWMODE:
+            mode = a[0];
+            oled.setDrawMode(mode);
+            break;
+        case CMD_SETFONT:
+            oled.setFontType(a[0]);
+            break;
+        case CMD_PRINT:
+            if (cache && mode == NORM) {
+                cache->Print(oled, texts[a[0]], oled.getCursorX(), oled.getCursorY(), color, false);
+            } else {
+                oled.print(texts[a[0]].c_str());
+            }
+            break;
+        case CMD_PRINTCENTERED:
+            if (cache && mode == NORM) {
+                cache->Print(oled, texts[a[1]], 0, a[0], color, true);
+            } else {
+                oled.setCursor(CenteredTextX(texts[a[1]].size()), a[0]);
+                oled.print(texts[a[1]].c_str());
+            }
+            break;
+        case CMD_DRAWBITMAP:
+            if (a[2] > 0 && a[3] > 0)
+                oled.drawBitmap(a[0], a[1], a[2], a[3], &bitmaps[a[4]], color, mode);
+            break;
+        }
+        i += 1 + ArgCount(ops[i]);
+    }
+}
+
+int CenteredTextX(size_t length)
+{
+    if (length > 32)
+        return 0;
+    return (32 - length) / 2;
+}
+
+}  // namespace screen
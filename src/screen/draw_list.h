@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "oled/Edison_OLED.h"
+
+namespace screen {
+
+class TextCache;
+
+// A list of draw operations applied to the screen buffer as one unit. ops is a
+// stream of commCommand_t op codes, each one followed by its arguments:
+//   CMD_CLEAR x y w h         CMD_SETCURSOR x y        CMD_PIXEL x y
+//   CMD_LINE x0 y0 x1 y1      CMD_LINEH x y w          CMD_LINEV x y h
+//   CMD_RECT x y w h          CMD_RECTFILL x y w h     CMD_CIRCLE x y r
+//   CMD_CIRCLEFILL x y r      CMD_DRAWCHAR x y c       CMD_SETCOLOR color
+//   CMD_SETDRAWMODE mode      CMD_SETFONT type         CMD_PRINT text
+//   CMD_PRINTCENTERED y text  CMD_DRAWBITMAP x y w h offset
+// text is an index into texts, offset is the start of a bitmap in bitmaps laid
+// out like edOLED::drawBitmap() expects it. Every list starts drawing in WHITE,
+// NORM mode, font 0 with the cursor at 0,0.
+struct DrawList {
+    std::vector<int32_t> ops;
+    std::vector<std::string> texts;
+    std::vector<uint8_t> bitmaps;
+
+    // Checks op codes, argument counts and ranges, text and bitmap references
+    bool Validate(std::string* error) const;
+
+    // True when the list starts by clearing the whole screen, so it does not
+    // depend on anything drawn before it
+    bool ClearsScreen() const;
+
+    // Draws the list into the screen buffer of oled without flushing it. Text
+    // drawn in NORM mode goes through cache when one is given.
+    void Apply(edOLED& oled, TextCache* cache) const;
+};
+
+// X position at which DisplayCenteredText starts a text of length characters
+int CenteredTextX(size_t length);
+
+}  // namespace screen
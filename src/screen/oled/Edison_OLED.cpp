@@ -23,11 +23,8 @@
 	along with this program. If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 #include "Edison_OLED.h"
-//#include "../spi/spi.h"
-//#include "../gpio/gpio.h"
-#include <spi.h>
-#include <gpio.h>
 #include "edison_fonts.h" // External file to store font bit-map arrays
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>	// for memset
 #include <stdio.h>	// for sprintf
@@ -112,31 +109,28 @@ static unsigned char screenmemory [] = {
 	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
 };
 
-// Pin definitions:
-//gpio CS_PIN(111, OUTPUT, HIGH);
-//gpio RST_PIN(15, OUTPUT, HIGH);
-//gpio DC_PIN(14, OUTPUT, HIGH);
-//gpio SCLK_PIN(109, SPI, HIGH);
-//gpio MOSI_PIN(115, SPI, HIGH);
-
-mraa_gpio_context RST_PIN;
-mraa_gpio_context DC_PIN;
-
+/** \brief edOLED shadow of the controller's GDRAM.
 
+Copy of the last screen buffer bytes transferred by display(), used to skip the
+parts of a frame that are already on the panel since GDRAM cannot be read back.
+*/
+static unsigned char shadowmemory [384];
 
-// SPI set up:
-//spiPort *spi5 = new spiPort();
-//spiDevice oledSPI(spi5);
-//spiDevice oledSPI(spi5, SPI_MODE_0, 10000000, false, &CS_PIN);
 #define pgm_read_byte(x) (*(x))
 
-//libmraa spi
-mraa_spi_context spi;
-
+/** \brief edOLED constructor.
 
-edOLED::edOLED()
+    All pin and SPI access goes through transport, which must outlive the edOLED.
+*/
+edOLED::edOLED(edOLEDTransport * transport)
 {
-
+	this->transport=transport;
+	dcLevel=0xFF;	// unknown until the first command or data transfer
+	ioCount=0;
+	frameSyscalls=0;
+	shadowValid=0;
+	coverage=NULL;
+	markAllDirty();
 }
 
 /** \brief Initialization of edOLED Library.
@@ -152,20 +146,17 @@ void edOLED::begin()
 	setDrawMode(NORM);
 	setCursor(0,0);
 	
-	RST_PIN = mraa_gpio_init(48);
-	DC_PIN = mraa_gpio_init(36);
-	mraa_gpio_dir(RST_PIN, MRAA_GPIO_OUT);
-	mraa_gpio_dir(DC_PIN, MRAA_GPIO_OUT);
-	spiSetup();
+	transport->begin();
+	dcLevel=0xFF;
 	
 	//RST_PIN.pinWrite(HIGH); //(digitalWrite(rstPin, HIGH);
-	mraa_gpio_write(RST_PIN,HIGH);
+	transport->setReset(HIGH);
 	usleep(5000); // VDD (3.3V) goes high at start, lets just chill for 5 ms
 	//RST_PIN.pinWrite(LOW); // bring reset low
-	mraa_gpio_write(RST_PIN,LOW);
+	transport->setReset(LOW);
 	usleep(10000); // wait 10ms
 	//RST_PIN.pinWrite(HIGH);	//digitalWrite(rstPin, HIGH);
-	mraa_gpio_write(RST_PIN,HIGH);
+	transport->setReset(HIGH);
 
 	// Init sequence for 64x48 OLED module
 	command(DISPLAYOFF);			// 0xAE
@@ -213,7 +204,7 @@ void edOLED::begin()
 void edOLED::command(unsigned char c)
 {
 	//DC_PIN.pinWrite(LOW); // DC pin LOW
-	mraa_gpio_write(DC_PIN,LOW);
+	setDC(LOW);
 	spiTransfer(c);
 }
 
@@ -224,10 +215,36 @@ void edOLED::command(unsigned char c)
 void edOLED::data(unsigned char c)
 {
 	//DC_PIN.pinWrite(HIGH);	// DC HIGH
-	mraa_gpio_write(DC_PIN,HIGH);
+	setDC(HIGH);
 	spiTransfer(c);
 }
 
+/** \brief SPI bulk data.
+
+    Setup DC pin once, then send len bytes of data to the SSD1306 controller
+    in a single SPI transaction.
+*/
+void edOLED::data(const unsigned char * buf, unsigned int len)
+{
+	setDC(HIGH);
+	spiTransfer(buf, len);
+}
+
+/** \brief Set DC pin level.
+
+    The DC pin only changes between command and data phases, so the GPIO
+    write is skipped when the pin is already at the requested level.
+*/
+void edOLED::setDC(unsigned char level)
+{
+	if (level==dcLevel)
+		return;
+
+	transport->setDC(level);
+	dcLevel=level;
+	ioCount++;
+}
+
 /** \brief Set SSD1306 page address.
 
     Send page address command and address to the SSD1306 OLED controller.
@@ -250,6 +267,22 @@ void edOLED::setColumnAddress(unsigned char add)
 	return;
 }
 
+/** \brief Set SSD1306 page and column address.
+
+    Same commands as setPageAddress() followed by setColumnAddress(), sent
+    as one 3 byte SPI transaction.
+*/
+void edOLED::setPageColumnAddress(unsigned char page, unsigned char col)
+{
+	unsigned char cmd[3];
+
+	cmd[0]=0xb0|page;
+	cmd[1]=(0x10|(col>>4))+0x02;
+	cmd[2]=0x0f&col;
+	setDC(LOW);
+	spiTransfer(cmd, 3);
+}
+
 /** \brief Clear screen buffer or SSD1306's memory.
  
     To clear GDRAM inside the LCD controller, pass in the variable mode =
@@ -260,18 +293,21 @@ void edOLED::clear(unsigned char mode)
 	//	unsigned char page=6, col=0x40;
 	if (mode==ALL)
 	{
-		for (int i=0;i<8; i++)
-		{
-			setPageAddress(i);
-			setColumnAddress(0);
-			for (int j=0; j<0x80; j++)
-			{
-				data(0);
-			}
-		}
+		clear(ALL, 0);
 	}
 	else
 	{
+		// only the columns that held lit pixels differ from a blank page
+		for (int i=0; i<LCDPAGES; i++)
+		{
+			unsigned char *page=&screenmemory[i*LCDWIDTH];
+			int x0=0, x1=LCDWIDTH-1;
+
+			while ((x0<=x1) && (page[x0]==0)) x0++;
+			while ((x1>=x0) && (page[x1]==0)) x1--;
+			if (x0<=x1)
+				markDirty(i,x0,x1);
+		}
 		memset(screenmemory,0,384);			// (64 x 48) / 8 = 384
 	}
 }
@@ -287,19 +323,23 @@ void edOLED::clear(unsigned char mode, unsigned char c)
 	//unsigned char page=6, col=0x40;
 	if (mode==ALL)
 	{
+		unsigned char fill[0x80];
+
+		memset(fill,c,0x80);
 		for (int i=0;i<8; i++)
 		{
-			setPageAddress(i);
-			setColumnAddress(0);
-			for (int j=0; j<0x80; j++)
-			{
-				data(c);
-			}
+			setPageColumnAddress(i,0);
+			data(fill,0x80);
 		}
+		// GDRAM no longer matches the screen buffer
+		memset(shadowmemory,c,384);
+		shadowValid=1;
+		markAllDirty();
 	}
 	else
 	{
 		memset(screenmemory,c,384);			// (64 x 48) / 8 = 384
+		markAllDirty();
 		display();
 	}	
 }
@@ -330,19 +370,89 @@ void edOLED::contrast(unsigned char contrast)
 /** \brief Transfer display memory.
 
     Bulk move the screen buffer to the SSD1306 controller's memory so that images/graphics drawn on the screen buffer will be displayed on the OLED.
+    Only the column range of each page changed since the last call is sent, as one address
+    command transfer followed by one data transfer. The range is first trimmed against the
+    shadow frame, so pages or whole frames identical to what is on the panel are skipped.
 */
 void edOLED::display(void)
 {
-	unsigned char i, j;
-	
-	for (i=0; i<6; i++)
+	unsigned char i, x0, x1;
+
+	ioCount=0;
+	for (i=0; i<LCDPAGES; i++)
 	{
-		setPageAddress(i);
-		setColumnAddress(0);
-		for (j=0;j<0x40;j++)
-		{
-			data(screenmemory[i*0x40+j]);
-		}
+		x0=dirtyMin[i];
+		x1=dirtyMax[i];
+		dirtyMin[i]=0xFF;
+		dirtyMax[i]=0;
+		if (x0>x1)
+			continue;
+		if (shadowValid && !trimToChanges(i,x0,x1))
+			continue;
+
+		setPageColumnAddress(i,x0);
+		data(&screenmemory[i*LCDWIDTH+x0],x1-x0+1);
+		memcpy(&shadowmemory[i*LCDWIDTH+x0],&screenmemory[i*LCDWIDTH+x0],x1-x0+1);
+	}
+	shadowValid=1;
+	frameSyscalls=ioCount;
+}
+
+/** \brief Trim a column range to the changed columns.
+
+    Shrink x0..x1 of page to the first and last columns that differ from the shadow frame,
+    comparing 4 columns at a time. Return false when the whole range matches.
+*/
+unsigned char edOLED::trimToChanges(unsigned char page, unsigned char &x0, unsigned char &x1)
+{
+	const unsigned char *mem=&screenmemory[page*LCDWIDTH];
+	const unsigned char *shadow=&shadowmemory[page*LCDWIDTH];
+	int first=x0, last=x1;
+	uint32_t a, b;
+
+	for (; first+3<=last; first+=4)
+	{
+		memcpy(&a,mem+first,4);
+		memcpy(&b,shadow+first,4);
+		if (a!=b)
+			break;
+	}
+	while ((first<=last) && (mem[first]==shadow[first])) first++;
+	if (first>last)
+		return false;
+
+	for (; last-3>=first; last-=4)
+	{
+		memcpy(&a,mem+last-3,4);
+		memcpy(&b,shadow+last-3,4);
+		if (a!=b)
+			break;
+	}
+	while (mem[last]==shadow[last]) last--;
+
+	x0=first;
+	x1=last;
+	return true;
+}
+
+/** \brief Mark screen buffer columns as changed.
+
+    Extend the changed column range of page to include x0..x1 so the next display() sends it.
+*/
+void edOLED::markDirty(unsigned char page, unsigned char x0, unsigned char x1)
+{
+	if (x0<dirtyMin[page]) dirtyMin[page]=x0;
+	if (x1>dirtyMax[page]) dirtyMax[page]=x1;
+}
+
+/** \brief Mark the whole screen buffer as changed.
+*/
+void edOLED::markAllDirty(void)
+{
+	for (int i=0; i<LCDPAGES; i++)
+	{
+		dirtyMin[i]=0;
+		dirtyMax[i]=LCDWIDTH-1;
 	}
 }
 
@@ -409,6 +519,24 @@ void edOLED::setCursor(unsigned char x, unsigned char y)
 	cursorY=y;
 }
 
+/** \brief Get cursor X position.
+
+    Return edOLED's cursor x position, where the next character is printed.
+*/
+unsigned char edOLED::getCursorX(void)
+{
+	return cursorX;
+}
+
+/** \brief Get cursor Y position.
+
+    Return edOLED's cursor y position, where the next character is printed.
+*/
+unsigned char edOLED::getCursorY(void)
+{
+	return cursorY;
+}
+
 /** \brief Draw pixel.
 
     Draw pixel using the current fore color and current draw mode in the screen buffer's x,y position.
@@ -427,6 +555,9 @@ void edOLED::pixel(unsigned char x, unsigned char y, unsigned char color, unsign
 	if ((x<0) ||  (x>=LCDWIDTH) || (y<0) || (y>=LCDHEIGHT))
 		return;
 
+	markDirty(y/8,x,x);
+	if (coverage)
+		coverage[x+ (y/8)*LCDWIDTH] |= (1<<(y%8));
 	if (mode==XOR)
 	{
 		if (color==WHITE)
@@ -509,7 +640,7 @@ void edOLED::line(unsigned char x0, unsigned char y0, unsigned char x1, unsigned
 */
 void edOLED::lineH(unsigned char x, unsigned char y, unsigned char width)
 {
-	line(x,y,x+width,y,foreColor,drawMode);
+	lineH(x,y,width,foreColor,drawMode);
 }
 
 /** \brief Draw horizontal line with color and mode.
@@ -518,7 +649,13 @@ void edOLED::lineH(unsigned char x, unsigned char y, unsigned char width)
 */
 void edOLED::lineH(unsigned char x, unsigned char y, unsigned char width, unsigned char color, unsigned char mode)
 {
-	line(x,y,x+width,y,color,mode);
+	// same pixels as line(x,y,x+width,y), which stops short of its end point
+	unsigned char x1=x+width;
+
+	if (x<x1)
+		spanRows(x,x1-1,y,y,color,mode);
+	else
+		spanRows(x1,x-1,y,y,color,mode);
 }
 
 /** \brief Draw vertical line.
@@ -527,7 +664,7 @@ void edOLED::lineH(unsigned char x, unsigned char y, unsigned char width, unsign
 */
 void edOLED::lineV(unsigned char x, unsigned char y, unsigned char height)
 {
-	line(x,y,x,y+height,foreColor,drawMode);
+	lineV(x,y,height,foreColor,drawMode);
 }
 
 /** \brief Draw vertical line with color and mode.
@@ -536,7 +673,13 @@ void edOLED::lineV(unsigned char x, unsigned char y, unsigned char height)
 */
 void edOLED::lineV(unsigned char x, unsigned char y, unsigned char height, unsigned char color, unsigned char mode)
 {
-	line(x,y,x,y+height,color,mode);
+	// same pixels as line(x,y,x,y+height), which stops short of its end point
+	unsigned char y1=y+height;
+
+	if (y<y1)
+		spanRows(x,x,y,y1-1,color,mode);
+	else
+		spanRows(x,x,y1,y-1,color,mode);
 }
 
 /** \brief Draw rectangle.
@@ -585,10 +728,19 @@ void edOLED::rectFill(unsigned char x, unsigned char y, unsigned char width, uns
 */	
 void edOLED::rectFill(unsigned char x, unsigned char y, unsigned char width, unsigned char height, unsigned char color , unsigned char mode)
 {
-	for (int i=x; i<x+width;i++)
-	{
-		lineV(i,y, height, color, mode);
-	}
+	// rows of lineV(i,y,height) for every column i
+	unsigned char y1=y+height;
+	int top=(y<y1) ? y : y1;
+	int bottom=((y<y1) ? y1 : y)-1;
+	int right=x+width-1;
+
+	if (width==0)
+		return;
+
+	spanRows(x,right,top,bottom,color,mode);
+	// columns past 255 wrap around to the left edge like the unsigned char column of lineV()
+	if (right>255)
+		spanRows(0,right-256,top,bottom,color,mode);
 }
 
 /** \brief Draw circle.
@@ -666,10 +818,7 @@ void edOLED::circleFill(unsigned char x0, unsigned char y0, unsigned char radius
 	// Temporary disable fill circle for XOR mode.
 	if (mode==XOR) return;
 
-	for (unsigned char i=y0-radius; i<=y0+radius; i++)
-	{
-		pixel(x0, i, color, mode);
-	}
+	spanColumn(x0, y0-radius, y0+radius, color, mode);
 
 	while (x<y)
 	{
@@ -683,19 +832,73 @@ void edOLED::circleFill(unsigned char x0, unsigned char y0, unsigned char radius
 		ddF_x += 2;
 		f += ddF_x;
 
-		for (unsigned char i=y0-y; i<=y0+y; i++)
-		{
-			pixel(x0+x, i, color, mode);
-			pixel(x0-x, i, color, mode);
-		}
-		for (unsigned char i=y0-x; i<=y0+x; i++)
-		{
-			pixel(x0+y, i, color, mode);
-			pixel(x0-y, i, color, mode);
-		}
+		spanColumn(x0+x, y0-y, y0+y, color, mode);
+		spanColumn(x0-x, y0-y, y0+y, color, mode);
+		spanColumn(x0+y, y0-x, y0+x, color, mode);
+		spanColumn(x0-y, y0-x, y0+x, color, mode);
+	}
+}
+
+/** \brief Draw column span.
+
+    Draw column x from row start to row end (inclusive) like a pixel() loop over an unsigned
+    char row counter starting at start would: nothing when start is past end.
+*/
+void edOLED::spanColumn(unsigned char x, unsigned char start, int end, unsigned char color, unsigned char mode)
+{
+	if (start<=end)
+		spanRows(x,x,start,end,color,mode);
+}
+
+/** \brief Draw filled span.
+
+    Draw columns x0 to x1 of rows y0 to y1 (both inclusive, clipped to the screen) with color
+    and mode, one masked byte operation per column of each page.
+*/
+void edOLED::spanRows(int x0, int x1, int y0, int y1, unsigned char color, unsigned char mode)
+{
+	if (y0<0) y0=0;
+	if (y1>LCDHEIGHT-1) y1=LCDHEIGHT-1;
+
+	for (int page=y0/8; (y0<=y1) && (page<=y1/8); page++)
+	{
+		int top=(y0>page*8) ? y0-page*8 : 0;
+		int bottom=(y1<page*8+7) ? y1-page*8 : 7;
+		maskColumns(page,x0,x1,(0xFF<<top) & (0xFF>>(7-bottom)),color,mode);
 	}
 }
 
+/** \brief Mask columns.
+
+    Apply the pixels of mask to columns x0 to x1 (clipped to the screen) of page, the way
+    pixel() applies color and mode to a single pixel.
+*/
+void edOLED::maskColumns(unsigned char page, int x0, int x1, unsigned char mask, unsigned char color, unsigned char mode)
+{
+	if (x0<0) x0=0;
+	if (x1>LCDWIDTH-1) x1=LCDWIDTH-1;
+	if ((x0>x1) || (mask==0))
+		return;
+
+	unsigned char *mem=&screenmemory[page*LCDWIDTH];
+	if (mode==XOR)
+	{
+		if (color==WHITE)
+			for (int i=x0; i<=x1; i++) mem[i]^=mask;
+	}
+	else
+	{
+		if (color==WHITE)
+			for (int i=x0; i<=x1; i++) mem[i]|=mask;
+		else
+			for (int i=x0; i<=x1; i++) mem[i]&=~mask;
+	}
+
+	if (coverage)
+		for (int i=x0; i<=x1; i++) coverage[i+page*LCDWIDTH]|=mask;
+	markDirty(page,x0,x1);
+}
+
 /** \brief Get LCD height.
 
     The height of the LCD return as unsigned char.
@@ -804,6 +1007,110 @@ void edOLED::setDrawMode(unsigned char mode)
 	drawMode=mode;
 }
 
+/** \brief Glyph byte offset.
+
+    Offset from the start of the current font (header included) of the 8 pixel high column col
+    in page row of character c. c must be within the font.
+*/
+unsigned int edOLED::glyphOffset(unsigned char c, unsigned char row, unsigned char col)
+{
+	unsigned int tempC=c-fontStartChar;
+	unsigned int charPerBitmapRow,charColPositionOnBitmap,charRowPositionOnBitmap,charBitmapStartPosition;
+
+	if (fontHeight<=8)
+		return FONTHEADERSIZE+(tempC*fontWidth)+col;
+
+	// font height over 8 bit
+	// take character "0" ASCII 48 as example
+	charPerBitmapRow=fontMapWidth/fontWidth;  // 256/8 =32 char per row
+	charColPositionOnBitmap=tempC % charPerBitmapRow;  // =16
+	charRowPositionOnBitmap=tempC/charPerBitmapRow; // =1
+	charBitmapStartPosition=(charRowPositionOnBitmap * fontMapWidth * (fontHeight/8)) + (charColPositionOnBitmap * fontWidth) ;
+
+	return FONTHEADERSIZE+charBitmapStartPosition+col+(row*fontMapWidth);
+}
+
+/** \brief Blit glyph column.
+
+    Draw the first rows (1 to 8) vertical pixels of bits (LSB on top) at column x from row y down,
+    with the same result as plotting set bits in color and clear bits in !color with pixel(). A page
+    aligned y touches one screen buffer byte, otherwise the column is shifted and masked into two.
+*/
+void edOLED::blitColumn(unsigned char x, unsigned char y, unsigned char bits, unsigned char color, unsigned char mode, unsigned char rows)
+{
+	unsigned char val, mask, colMask, page, shift;
+
+	if (x>=LCDWIDTH)
+		return;
+
+	if (y>256-rows)
+	{
+		// the rows wrap around like the unsigned char math of pixel(), do it the slow way
+		for (unsigned char j=0; j<rows; j++)
+		{
+			pixel(x, y+j, (bits & (1<<j)) ? color : !color, mode);
+		}
+		return;
+	}
+
+	// pixels that end up WHITE (NORM) or get toggled (XOR)
+	val=0;
+	if (color==WHITE) val|=bits;
+	if ((!color)==WHITE) val|=~bits;
+	colMask=0xFF>>(8-rows);
+
+	page=y/8;
+	shift=y%8;
+	for (unsigned char k=0; k<2; k++, page++)
+	{
+		if (page>=LCDPAGES)
+			return;
+
+		unsigned char *mem=&screenmemory[x+page*LCDWIDTH];
+		unsigned char v;
+		if (k==0)
+		{
+			mask=colMask<<shift;
+			v=val<<shift;
+		}
+		else
+		{
+			mask=colMask>>(8-shift);
+			v=val>>(8-shift);
+			if (mask==0)
+				return;
+		}
+
+		if (mode==XOR)
+			*mem^=v & mask;
+		else
+			*mem=(*mem & ~mask) | (v & mask);
+		if (coverage)
+			coverage[x+page*LCDWIDTH] |= mask;
+		markDirty(page,x,x);
+	}
+}
+
+/** \brief Draw bitmap with color and mode.
+
+    Draw a width x height bitmap at x,y using color and draw mode. The bitmap uses the screen
+    buffer layout: bands of 8 rows, each band width bytes long with the top row in the LSB.
+*/
+void edOLED::drawBitmap(unsigned char x, unsigned char y, unsigned char width, unsigned char height, const unsigned char * bitmap, unsigned char color, unsigned char mode)
+{
+	unsigned char band, i, rows;
+
+	for (band=0; band*8<height; band++)
+	{
+		rows=height-band*8;
+		if (rows>8) rows=8;
+		for (i=0; i<width; i++)
+		{
+			blitColumn(x+i, y+band*8, bitmap[band*width+i], color, mode, rows);
+		}
+	}
+}
+
 /** \brief Draw character.
 
     Draw character c using current color and current draw mode at x,y.
@@ -815,9 +1122,49 @@ void  edOLED::drawChar(unsigned char x, unsigned char y, unsigned char c)
 
 /** \brief Draw character with color and mode.
 
-    Draw character c using color and draw mode at x,y.
+    Draw character c using color and draw mode at x,y. Each 8 pixel high glyph column is
+    written straight into the screen buffer with blitColumn().
 */
 void  edOLED::drawChar(unsigned char x, unsigned char y, unsigned char c, unsigned char color, unsigned char mode)
+{
+	unsigned char rowsToDraw,row;
+	unsigned char i,temp;
+
+	if ((c<fontStartChar) || (c>(fontStartChar+fontTotalChar-1)))		// no bitmap for the required c
+	return;
+
+	// each row (in datasheet is call page) is 8 bits high, 16 bit high character will have 2 rows to be drawn
+	rowsToDraw=fontHeight/8;	// 8 is LCD's page size, see SSD1306 datasheet
+	if (rowsToDraw<=1)
+	{
+		for  (i=0;i<fontWidth+1;i++)
+		{
+			if (i==fontWidth) // for 5x7 font there is no margin, this adds a blank column after col 5
+				temp=0;
+			else
+				temp=pgm_read_byte(fontsPointer[fontType]+glyphOffset(c,0,i));
+
+			blitColumn(x+i, y, temp, color, mode, 8);
+		}
+		return;
+	}
+
+	for(row=0;row<rowsToDraw;row++)
+	{
+		for (i=0; i<fontWidth;i++)
+		{
+			temp=pgm_read_byte(fontsPointer[fontType]+glyphOffset(c,row,i));
+			blitColumn(x+i, y+(row*8), temp, color, mode, 8);
+		}
+	}
+}
+
+/** \brief Draw character pixel by pixel.
+
+    Reference implementation of drawChar() that plots every glyph bit with pixel().
+    Kept to check and benchmark the column blitter against.
+*/
+void  edOLED::drawCharPixel(unsigned char x, unsigned char y, unsigned char c, unsigned char color, unsigned char mode)
 {
 	unsigned char rowsToDraw,row, tempC;
 	unsigned char i,j,temp;
@@ -889,6 +1236,51 @@ void  edOLED::drawChar(unsigned char x, unsigned char y, unsigned char c, unsign
 
 }
 
+/** \brief Get frame syscalls.
+
+    Return the number of GPIO and SPI calls made by the last display().
+*/
+unsigned int edOLED::getFrameSyscalls(void)
+{
+	return frameSyscalls;
+}
+
+/** \brief Get screen buffer.
+
+    Return the 384 byte screen buffer, one byte per column of each 8 pixel high page.
+*/
+const unsigned char * edOLED::getScreenBuffer(void)
+{
+	return screenmemory;
+}
+
+/** \brief Set coverage mask.
+
+    While coverage points to a 384 byte buffer laid out like the screen buffer, every pixel
+    drawn is also set in it. Pass NULL to stop recording.
+*/
+void edOLED::setCoverage(unsigned char * coverage)
+{
+	this->coverage=coverage;
+}
+
+/** \brief Blend bytes into the screen buffer.
+
+    Copy the bits selected by masks from bytes into width columns of page starting at x.
+*/
+void edOLED::blend(unsigned char page, unsigned char x, unsigned char width, const unsigned char * bytes, const unsigned char * masks)
+{
+	if ((page>=LCDPAGES) || (width==0) || (x+width>LCDWIDTH))
+		return;
+
+	unsigned char *mem=&screenmemory[x+page*LCDWIDTH];
+	for (unsigned char i=0; i<width; i++)
+	{
+		mem[i]=(mem[i] & ~masks[i]) | (bytes[i] & masks[i]);
+	}
+	markDirty(page,x,x+width-1);
+}
+
 /** \brief Stop scrolling.
 
     Stop the scrolling of graphics on the OLED.
@@ -896,6 +1288,9 @@ void  edOLED::drawChar(unsigned char x, unsigned char y, unsigned char c, unsign
 void edOLED::scrollStop(void)
 {
 	command(DEACTIVATESCROLL);
+	// scrolling moves GDRAM content, it has to be rewritten from the screen buffer
+	shadowValid=0;
+	markAllDirty();
 }
 
 /** \brief Right scrolling.
@@ -949,18 +1344,15 @@ void edOLED::flipHorizontal(unsigned char flip)
 	}
 }
 
-void edOLED::spiSetup()
+void edOLED::spiTransfer(unsigned char data)
 {
-	spi = mraa_spi_init(0);
-    	if (spi == NULL) {
-        	printf("Initialization of spi failed, check syslog for details, exit...\n");
-        	exit(1);
-	}
-	
+	//oledSPI.transferData(&data);	//, NULL, 1, true);
+	transport->write(&data, 1);
+	ioCount++;
 }
 
-void edOLED::spiTransfer(unsigned char data)
+void edOLED::spiTransfer(const unsigned char * buf, unsigned int len)
 {
-	//oledSPI.transferData(&data);	//, NULL, 1, true);
-	mraa_spi_write_buf(spi, &data, 1);
+	transport->write(buf, len);
+	ioCount++;
 }
@@ -26,6 +26,8 @@
 #ifndef EDISON_OLED_H
 #define EDISON_OLED_H
 
+#include "oled_transport.h"
+
 #define swapOLED(a, b) { unsigned char t = a; a = b; b = t; }
 
 #define BLACK 0
@@ -34,6 +36,7 @@
 #define LCDWIDTH			64
 #define LCDHEIGHT			48
 #define FONTHEADERSIZE		6
+#define LCDPAGES			(LCDHEIGHT/8)
 
 #define NORM				0
 #define XOR					1
@@ -96,12 +99,15 @@ typedef enum CMD {
 	CMD_GETLCDWIDTH,	//15
 	CMD_GETLCDHEIGHT,	//16
 	CMD_SETCOLOR,		//17
-	CMD_SETDRAWMODE		//18
+	CMD_SETDRAWMODE,	//18
+	CMD_PRINT,			//19
+	CMD_PRINTCENTERED,	//20
+	CMD_SETFONT			//21
 } commCommand_t;
 
 class edOLED {
 public:
-	edOLED();
+	edOLED(edOLEDTransport * transport);
 	
 	void begin(void);
 
@@ -113,6 +119,7 @@ public:
 	// RAW LCD functions
 	void command(unsigned char c);
 	void data(unsigned char c);
+	void data(const unsigned char * buf, unsigned int len);
 	void setColumnAddress(unsigned char add);
 	void setPageAddress(unsigned char add);
 	
@@ -123,6 +130,8 @@ public:
 	void contrast(unsigned char contrast);
 	void display(void);
 	void setCursor(unsigned char x, unsigned char y);
+	unsigned char getCursorX(void);
+	unsigned char getCursorY(void);
 	void pixel(unsigned char x, unsigned char y);
 	void pixel(unsigned char x, unsigned char y, unsigned char color, unsigned char mode);
 	void line(unsigned char x0, unsigned char y0, unsigned char x1, unsigned char y1);
@@ -141,7 +150,9 @@ public:
 	void circleFill(unsigned char x0, unsigned char y0, unsigned char radius, unsigned char color, unsigned char mode);
 	void drawChar(unsigned char x, unsigned char y, unsigned char c);
 	void drawChar(unsigned char x, unsigned char y, unsigned char c, unsigned char color, unsigned char mode);
+	void drawCharPixel(unsigned char x, unsigned char y, unsigned char c, unsigned char color, unsigned char mode);
 	void drawBitmap(void);
+	void drawBitmap(unsigned char x, unsigned char y, unsigned char width, unsigned char height, const unsigned char * bitmap, unsigned char color, unsigned char mode);
 	unsigned char getLCDWidth(void);
 	unsigned char getLCDHeight(void);
 	void setColor(unsigned char color);
@@ -164,6 +175,14 @@ public:
 	void scrollStop(void);
 	void flipVertical(unsigned char flip);
 	void flipHorizontal(unsigned char flip);
+
+	// Transfer statistics
+	unsigned int getFrameSyscalls(void);
+
+	// Screen buffer access
+	const unsigned char * getScreenBuffer(void);
+	void setCoverage(unsigned char * coverage);
+	void blend(unsigned char page, unsigned char x, unsigned char width, const unsigned char * bytes, const unsigned char * masks);
 	
 	//void doCmd(unsigned char index);
 	
@@ -171,9 +190,29 @@ private:
 	unsigned char foreColor,drawMode,fontWidth, fontHeight, fontType, fontStartChar, fontTotalChar, cursorX, cursorY;
 	unsigned int fontMapWidth;
 	static const unsigned char *fontsPointer[];
+	edOLEDTransport *transport;
+	unsigned char dcLevel;
+	unsigned int ioCount, frameSyscalls;
+	// Changed column range of each page since the last display(), empty when min > max
+	unsigned char dirtyMin[LCDPAGES], dirtyMax[LCDPAGES];
+	// The shadow frame holds what GDRAM contains, only while shadowValid
+	unsigned char shadowValid;
+	// When set, every drawn pixel is also recorded in this screen buffer sized bit mask
+	unsigned char *coverage;
+
+	void markDirty(unsigned char page, unsigned char x0, unsigned char x1);
+	void markAllDirty(void);
+	unsigned char trimToChanges(unsigned char page, unsigned char &x0, unsigned char &x1);
+	void blitColumn(unsigned char x, unsigned char y, unsigned char bits, unsigned char color, unsigned char mode, unsigned char rows);
+	unsigned int glyphOffset(unsigned char c, unsigned char row, unsigned char col);
+	void spanColumn(unsigned char x, unsigned char start, int end, unsigned char color, unsigned char mode);
+	void spanRows(int x0, int x1, int y0, int y1, unsigned char color, unsigned char mode);
+	void maskColumns(unsigned char page, int x0, int x1, unsigned char mask, unsigned char color, unsigned char mode);
 					  
 	// Communication
+	void setDC(unsigned char level);
+	void setPageColumnAddress(unsigned char page, unsigned char col);
 	void spiTransfer(unsigned char data);
-	void spiSetup();
+	void spiTransfer(const unsigned char * buf, unsigned int len);
 };
 #endif
@@ -0,0 +1,203 @@
+/******************************************************************************
+	memory_transport.cpp
+	In-memory edOLED transport.
+******************************************************************************/
+#include "memory_transport.h"
+#include "Edison_OLED.h"
+#include <stdio.h>
+#include <string.h>
+
+// First GDRAM column of the 64 pixel wide window, see edOLED::setColumnAddress()
+#define VISIBLECOLUMN	32
+
+memoryTransport::memoryTransport()
+{
+	recording=true;
+	reset();
+	memset(gdram,0,sizeof(gdram));
+	dc=LOW;
+	page=0;
+	column=0;
+	skipArgs=0;
+}
+
+void memoryTransport::begin(void)
+{
+}
+
+void memoryTransport::setReset(unsigned char level)
+{
+	if (level==LOW)
+	{
+		page=0;
+		column=0;
+		skipArgs=0;
+	}
+}
+
+void memoryTransport::setDC(unsigned char level)
+{
+	dc=level;
+	dcWrites++;
+}
+
+void memoryTransport::write(const unsigned char * buf, unsigned int len)
+{
+	transfers++;
+	for (unsigned int i=0; i<len; i++)
+	{
+		if (recording)
+		{
+			bytes.push_back(buf[i]);
+			dcLevels.push_back(dc);
+		}
+
+		if (dc==HIGH)
+		{
+			// page addressing mode, the column pointer wraps within the page
+			gdram[page*128+column]=buf[i];
+			column=(column+1) & 0x7F;
+			dataBytes++;
+		}
+		else
+		{
+			command(buf[i]);
+			commandBytes++;
+		}
+	}
+}
+
+/** \brief Replay a command byte.
+
+    Only page and column addressing changes GDRAM writes, the arguments of other
+    multi byte commands are skipped.
+*/
+void memoryTransport::command(unsigned char c)
+{
+	if (skipArgs)
+	{
+		skipArgs--;
+		return;
+	}
+
+	if ((c & 0xF0)==0xB0)
+		page=c & 0x07;
+	else if (c<=0x0F)
+		column=(column & 0xF0) | c;
+	else if ((c & 0xF0)==SETHIGHCOLUMN)
+		column=(column & 0x0F) | ((c & 0x0F)<<4);
+	else
+	{
+		switch (c)
+		{
+			case SETCONTRAST:
+			case SETDISPLAYCLOCKDIV:
+			case SETMULTIPLEX:
+			case SETDISPLAYOFFSET:
+			case CHARGEPUMP:
+			case SETCOMPINS:
+			case SETPRECHARGE:
+			case SETVCOMDESELECT:
+			case MEMORYMODE:
+				skipArgs=1;
+				break;
+			case RIGHTHORIZONTALSCROLL:
+			case LEFT_HORIZONTALSCROLL:
+				skipArgs=6;
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+void memoryTransport::setRecording(bool record)
+{
+	recording=record;
+}
+
+/** \brief Reset the recorded stream and counters.
+
+    GDRAM contents are kept.
+*/
+void memoryTransport::reset(void)
+{
+	bytes.clear();
+	dcLevels.clear();
+	transfers=0;
+	dcWrites=0;
+	commandBytes=0;
+	dataBytes=0;
+}
+
+const std::vector<unsigned char> & memoryTransport::getBytes(void)
+{
+	return bytes;
+}
+
+const std::vector<unsigned char> & memoryTransport::getDCLevels(void)
+{
+	return dcLevels;
+}
+
+unsigned long memoryTransport::getTransfers(void)
+{
+	return transfers;
+}
+
+unsigned long memoryTransport::getDCWrites(void)
+{
+	return dcWrites;
+}
+
+unsigned long memoryTransport::getCommandBytes(void)
+{
+	return commandBytes;
+}
+
+unsigned long memoryTransport::getDataBytes(void)
+{
+	return dataBytes;
+}
+
+const unsigned char * memoryTransport::getGDRAM(void)
+{
+	return gdram;
+}
+
+void memoryTransport::getVisible(unsigned char * buf)
+{
+	for (int i=0; i<LCDPAGES; i++)
+	{
+		memcpy(&buf[i*LCDWIDTH],&gdram[i*128+VISIBLECOLUMN],LCDWIDTH);
+	}
+}
+
+/** \brief Write a PBM image.
+
+    Write width x height pixels of buf, laid out in 8 pixel high pages like the screen buffer,
+    as a binary PBM (P4) file. Lit pixels are black in the image. Return 0 on success.
+*/
+int writePBM(const char * path, const unsigned char * buf, int width, int height)
+{
+	FILE *f=fopen(path,"wb");
+	if (f==NULL)
+		return -1;
+
+	fprintf(f,"P4\n%d %d\n",width,height);
+	for (int y=0; y<height; y++)
+	{
+		unsigned char packed=0;
+		for (int x=0; x<width; x++)
+		{
+			if (buf[x+(y/8)*width] & (1<<(y%8)))
+				packed|=0x80>>(x%8);
+			if ((x%8==7) || (x==width-1))
+			{
+				fputc(packed,f);
+				packed=0;
+			}
+		}
+	}
+	return (fclose(f)==0) ? 0 : -1;
+}
@@ -0,0 +1,54 @@
+/******************************************************************************
+	memory_transport.h
+	In-memory edOLED transport.
+
+	Records the byte stream edOLED sends and replays the page addressing
+	commands into a copy of the controller's GDRAM, so rendering and transfer
+	costs can be measured and checked without the OLED Block.
+******************************************************************************/
+
+#ifndef MEMORY_TRANSPORT_H
+#define MEMORY_TRANSPORT_H
+
+#include "oled_transport.h"
+#include <vector>
+
+class memoryTransport : public edOLEDTransport {
+public:
+	memoryTransport();
+
+	void begin(void);
+	void setReset(unsigned char level);
+	void setDC(unsigned char level);
+	void write(const unsigned char * buf, unsigned int len);
+
+	// Recording control
+	void setRecording(bool record);
+	void reset(void);
+
+	// Bytes sent since the last reset(), each tagged with the DC level it was sent with
+	const std::vector<unsigned char> & getBytes(void);
+	const std::vector<unsigned char> & getDCLevels(void);
+	unsigned long getTransfers(void);
+	unsigned long getDCWrites(void);
+	unsigned long getCommandBytes(void);
+	unsigned long getDataBytes(void);
+
+	// Simulated controller memory, 8 pages of 128 columns
+	const unsigned char * getGDRAM(void);
+	// The 64 x 48 window of GDRAM the OLED Block shows, in screen buffer layout
+	void getVisible(unsigned char * buf);
+
+private:
+	bool recording;
+	std::vector<unsigned char> bytes, dcLevels;
+	unsigned long transfers, dcWrites, commandBytes, dataBytes;
+	unsigned char dc, page, column, skipArgs;
+	unsigned char gdram[8*128];
+
+	void command(unsigned char c);
+};
+
+// Write a screen buffer laid out like edOLED's as a binary PBM image
+int writePBM(const char * path, const unsigned char * buf, int width, int height);
+#endif
@@ -0,0 +1,55 @@
+/******************************************************************************
+	mraa_transport.cpp
+	edOLED transport for the Edison OLED Block wired to the Edison's SPI port,
+	driven through libmraa.
+******************************************************************************/
+#include "mraa_transport.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Pin definitions:
+//gpio CS_PIN(111, OUTPUT, HIGH);
+//gpio RST_PIN(15, OUTPUT, HIGH);
+//gpio DC_PIN(14, OUTPUT, HIGH);
+//gpio SCLK_PIN(109, SPI, HIGH);
+//gpio MOSI_PIN(115, SPI, HIGH);
+
+mraaTransport::mraaTransport()
+{
+	RST_PIN=NULL;
+	DC_PIN=NULL;
+	spi=NULL;
+}
+
+/** \brief Set up pins and SPI port.
+
+    Reset and DC are outputs on GPIO 48 and 36, the OLED sits on SPI bus 0.
+*/
+void mraaTransport::begin(void)
+{
+	RST_PIN = mraa_gpio_init(48);
+	DC_PIN = mraa_gpio_init(36);
+	mraa_gpio_dir(RST_PIN, MRAA_GPIO_OUT);
+	mraa_gpio_dir(DC_PIN, MRAA_GPIO_OUT);
+
+	spi = mraa_spi_init(0);
+	if (spi == NULL) {
+		printf("Initialization of spi failed, check syslog for details, exit...\n");
+		exit(1);
+	}
+}
+
+void mraaTransport::setReset(unsigned char level)
+{
+	mraa_gpio_write(RST_PIN,level);
+}
+
+void mraaTransport::setDC(unsigned char level)
+{
+	mraa_gpio_write(DC_PIN,level);
+}
+
+void mraaTransport::write(const unsigned char * buf, unsigned int len)
+{
+	mraa_spi_write_buf(spi, const_cast<unsigned char *>(buf), len);
+}
@@ -0,0 +1,28 @@
+/******************************************************************************
+	mraa_transport.h
+	edOLED transport for the Edison OLED Block wired to the Edison's SPI port,
+	driven through libmraa.
+******************************************************************************/
+
+#ifndef MRAA_TRANSPORT_H
+#define MRAA_TRANSPORT_H
+
+#include "oled_transport.h"
+#include <spi.h>
+#include <gpio.h>
+
+class mraaTransport : public edOLEDTransport {
+public:
+	mraaTransport();
+
+	void begin(void);
+	void setReset(unsigned char level);
+	void setDC(unsigned char level);
+	void write(const unsigned char * buf, unsigned int len);
+
+private:
+	mraa_gpio_context RST_PIN;
+	mraa_gpio_context DC_PIN;
+	mraa_spi_context spi;
+};
+#endif
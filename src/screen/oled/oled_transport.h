@@ -0,0 +1,26 @@
+/******************************************************************************
+	oled_transport.h
+	Hardware interface used by edOLED to talk to the SSD1306 controller.
+
+	edOLED only drives the reset and data/command pins and writes bytes over
+	SPI, so the rendering code can run against the Edison's libmraa port or
+	against an in-memory backend for benchmarks and off-device checks.
+******************************************************************************/
+
+#ifndef OLED_TRANSPORT_H
+#define OLED_TRANSPORT_H
+
+class edOLEDTransport {
+public:
+	virtual ~edOLEDTransport() {}
+
+	// Set up the pins and SPI port
+	virtual void begin(void) = 0;
+	// Drive the controller's reset pin
+	virtual void setReset(unsigned char level) = 0;
+	// Drive the data/command pin, LOW for commands and HIGH for data
+	virtual void setDC(unsigned char level) = 0;
+	// Send len bytes in one SPI transaction
+	virtual void write(const unsigned char * buf, unsigned int len) = 0;
+};
+#endif
@@ -1,16 +1,24 @@
 #include "oled/Edison_OLED.h"
+#include "oled/mraa_transport.h"
+#include "draw_list.h"
+#include "text_cache.h"
 #include "navigator/services/screen/BnScreenService.h"
 #include "binder_constants.h"
 #include <gpio.h>
 #include <stdio.h>
 
+#include <condition_variable>
+#include <mutex>
 #include <string>
 #include <sysexits.h>
+#include <thread>
+#include <vector>
 
 #include <base/bind.h>
 #include <base/command_line.h>
 #include <base/macros.h>
 #include <base/memory/weak_ptr.h>
+#include <base/time/time.h>
 #include <binderwrapper/binder_wrapper.h>
 #include <brillo/binder_watcher.h>
 #include <brillo/daemons/daemon.h>
@@ -18,20 +26,56 @@
 #include <utils/String16.h>
 
 using android::String16;
+using screen::DrawList;
+using screen::TextCache;
+
+namespace {
+// Number of rendered frames between two metrics log lines
+const unsigned int kMetricsLogInterval = 50;
+// Number of rendered texts kept, the navigator only shows a few location names
+const size_t kTextCacheCapacity = 16;
+}  // anonymous namespace
 
 class ScreenService : public navigator::services::screen::BnScreenService {
 public:
+    ~ScreenService();
     void InitializeService();
     android::binder::Status DisplayText(const String16& s, int x, int y);
     android::binder::Status DisplayCenteredText(const String16& s);
     android::binder::Status TagPositionLost();
+    android::binder::Status DrawBatch(const std::vector<int32_t>& ops,
+                                      const std::vector<String16>& texts,
+                                      const std::vector<int8_t>& bitmaps);
         
 private:
     void SetupButtons();
     void SetupOLED();
     void StartScreen();
-    // Define an edOLED object:
-    edOLED oled;
+    void Flush();
+    void Submit(DrawList list);
+    void RenderLoop();
+
+    // Latest-wins mailbox between binder calls and the render thread. Lists
+    // that clear the whole screen discard the ones still pending.
+    std::mutex scene_mutex_;
+    std::condition_variable scene_cv_;
+    std::vector<DrawList> pending_lists_;
+    // Submission time of the oldest pending list
+    base::TimeTicks pending_since_;
+    bool stop_rendering_ = false;
+    std::thread render_thread_;
+
+    // Render metrics, frames_dropped_ is guarded by scene_mutex_
+    unsigned int frames_dropped_ = 0;
+    unsigned int frames_rendered_ = 0;
+    base::TimeDelta latency_total_;
+    base::TimeDelta latency_max_;
+    // Only used by the render thread
+    TextCache text_cache_{kTextCacheCapacity};
+
+    // Define an edOLED object on the Edison's SPI port:
+    mraaTransport oled_transport_;
+    edOLED oled{&oled_transport_};
     mraa_gpio_context BUTTON_UP;
     mraa_gpio_context BUTTON_DOWN;
     mraa_gpio_context BUTTON_LEFT;
@@ -57,11 +101,26 @@ private:
     DISALLOW_COPY_AND_ASSIGN(Daemon);
 };
 
+ScreenService::~ScreenService()
+{
+    if (render_thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(scene_mutex_);
+            stop_rendering_ = true;
+        }
+        scene_cv_.notify_one();
+        render_thread_.join();
+    }
+}
+
 void ScreenService::InitializeService()
 {
     SetupButtons();
     SetupOLED();
     StartScreen();
+
+    // From here on the OLED is only touched by the render thread
+    render_thread_ = std::thread(&ScreenService::RenderLoop, this);
 }
 
 void ScreenService::SetupButtons()
@@ -102,17 +161,84 @@ void ScreenService::StartScreen()
     oled.setCursor(2, 25);
     oled.print("SERVICE UP");
     // Call display to actually draw it on the OLED:
+    Flush();
+}
+
+//Transfers the screen buffer to the OLED
+void ScreenService::Flush()
+{
     oled.display();
+    VLOG(1) << "Frame flushed with " << oled.getFrameSyscalls() << " syscalls";
+}
+
+//Queues a draw list for the render thread
+void ScreenService::Submit(DrawList list)
+{
+    {
+        std::lock_guard<std::mutex> lock(scene_mutex_);
+        if (list.ClearsScreen()) {
+            frames_dropped_ += pending_lists_.size();
+            pending_lists_.clear();
+        }
+        if (pending_lists_.empty())
+            pending_since_ = base::TimeTicks::Now();
+        pending_lists_.push_back(std::move(list));
+    }
+    scene_cv_.notify_one();
+}
+
+//Draws all pending lists with a single flush whenever there are some
+void ScreenService::RenderLoop()
+{
+    while (true) {
+        std::vector<DrawList> lists;
+        base::TimeTicks queued;
+        {
+            std::unique_lock<std::mutex> lock(scene_mutex_);
+            scene_cv_.wait(lock, [this] { return !pending_lists_.empty() || stop_rendering_; });
+            if (stop_rendering_)
+                return;
+            lists.swap(pending_lists_);
+            queued = pending_since_;
+        }
+
+        for (const DrawList& list : lists)
+            list.Apply(oled, &text_cache_);
+        // Call display to actually draw it on the OLED:
+        Flush();
+
+        base::TimeDelta latency = base::TimeTicks::Now() - queued;
+        frames_rendered_++;
+        latency_total_ += latency;
+        if (latency > latency_max_)
+            latency_max_ = latency;
+        VLOG(1) << "Frame on glass " << latency.InMilliseconds() << " ms after submission";
+
+        if (frames_rendered_ % kMetricsLogInterval == 0) {
+            unsigned int dropped;
+            {
+                std::lock_guard<std::mutex> lock(scene_mutex_);
+                dropped = frames_dropped_;
+            }
+            LOG(INFO) << "Screen frames rendered: " << frames_rendered_
+                      << " dropped: " << dropped
+                      << " avg latency: " << (latency_total_ / frames_rendered_).InMilliseconds() << " ms"
+                      << " max latency: " << latency_max_.InMilliseconds() << " ms"
+                      << " text cache hits: " << text_cache_.hits()
+                      << " misses: " << text_cache_.misses();
+        }
+    }
 }
 
 //Implementation of service call to display text on screen
 android::binder::Status ScreenService::DisplayText(const String16& s, int x, int y)
 {
-    oled.clear(PAGE);
-    oled.setCursor(x, y);
-    oled.print(android::String8(s).string());
-    // Call display to actually draw it on the OLED:
-    oled.display();
+    DrawList list;
+    list.ops = {CMD_CLEAR, 0, 0, LCDWIDTH, LCDHEIGHT,
+                CMD_SETCURSOR, x, y,
+                CMD_PRINT, 0};
+    list.texts.push_back(android::String8(s).string());
+    Submit(std::move(list));
     
     return android::binder::Status::ok();
 }
@@ -120,21 +246,8 @@ android::binder::Status ScreenService::DisplayText(const String16& s, int x, int
 //Implementation of service call to display centered text on screen
 android::binder::Status ScreenService::DisplayCenteredText(const String16& s)
 {
-    unsigned int x;
-    
-    size_t size = s.size();
-    
-    if(size > 32)
-        x = 0;
-    else
-        x = (32 - size)/2;
-    
-    oled.clear(PAGE);
-    oled.setCursor(x, 25);
-    oled.print(android::String8(s).string());
-    
-    // Call display to actually draw it on the OLED:
-    oled.display();
+    // Centered on the UTF-16 length, as the text is sent
+    DisplayText(s, screen::CenteredTextX(s.size()), 25);
     
     return android::binder::Status::ok();
 }
@@ -142,14 +255,35 @@ android::binder::Status ScreenService::DisplayCenteredText(const String16& s)
 //Prints a circle on the top right corner to indicate position lost
 android::binder::Status ScreenService::TagPositionLost()
 {
-    oled.circleFill(59,6,3);
-    
-    // Call display to actually draw it on the OLED:
-    oled.display();
+    DrawList list;
+    list.ops = {CMD_CIRCLEFILL, 59, 6, 3};
+    Submit(std::move(list));
     
     return android::binder::Status::ok();
 }
 
+//Implementation of service call to draw a batch of operations with one flush
+android::binder::Status ScreenService::DrawBatch(const std::vector<int32_t>& ops,
+                                                 const std::vector<String16>& texts,
+                                                 const std::vector<int8_t>& bitmaps)
+{
+    DrawList list;
+    list.ops = ops;
+    for (const String16& text : texts)
+        list.texts.push_back(android::String8(text).string());
+    list.bitmaps.assign(bitmaps.begin(), bitmaps.end());
+
+    std::string error;
+    if (!list.Validate(&error)) {
+        LOG(ERROR) << "Rejected draw batch: " << error;
+        return android::binder::Status::fromExceptionCode(
+            android::binder::Status::EX_ILLEGAL_ARGUMENT, android::String8(error.c_str()));
+    }
+    Submit(std::move(list));
+
+    return android::binder::Status::ok();
+}
+
 int Daemon::OnInit() {
     int return_code = brillo::Daemon::OnInit();
     if (return_code != EX_OK)
@@ -0,0 +1,79 @@
+#include "text_cache.h"
+#include "draw_list.h"
+
+#include <string.h>
+
+namespace screen {
+
+TextCache::TextCache(size_t capacity) : capacity_(capacity) {}
+
+void TextCache::Print(edOLED& oled, const std::string& text, unsigned char x,
+                      unsigned char y, unsigned char color, bool centered)
+{
+    if (centered)
+        x = CenteredTextX(text.size());
+
+    std::string key = text;
+    key.push_back('\0');
+    key.push_back(oled.getFontType());
+    key.push_back(x);
+    key.push_back(y);
+    key.push_back(color);
+
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        hits_++;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        const Entry& entry = entries_.front();
+        for (const Span& span : entry.spans)
+            oled.blend(span.page, span.x0, span.bytes.size(), span.bytes.data(), span.masks.data());
+        oled.setCursor(entry.cursorX, entry.cursorY);
+        return;
+    }
+
+    misses_++;
+    Entry entry;
+    entry.key = key;
+    Render(oled, text, x, y, &entry);
+
+    entries_.push_front(std::move(entry));
+    index_[key] = entries_.begin();
+    if (entries_.size() > capacity_) {
+        index_.erase(entries_.back().key);
+        entries_.pop_back();
+    }
+}
+
+void TextCache::Render(edOLED& oled, const std::string& text, unsigned char x,
+                       unsigned char y, Entry* entry)
+{
+    unsigned char coverage[LCDWIDTH * LCDPAGES];
+
+    memset(coverage, 0, sizeof(coverage));
+    oled.setCoverage(coverage);
+    oled.setCursor(x, y);
+    oled.print(text.c_str());
+    oled.setCoverage(NULL);
+
+    entry->cursorX = oled.getCursorX();
+    entry->cursorY = oled.getCursorY();
+
+    const unsigned char* screen = oled.getScreenBuffer();
+    for (int page = 0; page < LCDPAGES; page++) {
+        const unsigned char* covered = &coverage[page * LCDWIDTH];
+        int x0 = 0, x1 = LCDWIDTH - 1;
+        while (x0 <= x1 && covered[x0] == 0) x0++;
+        while (x1 >= x0 && covered[x1] == 0) x1--;
+        if (x0 > x1)
+            continue;
+
+        Span span;
+        span.page = page;
+        span.x0 = x0;
+        span.bytes.assign(screen + page * LCDWIDTH + x0, screen + page * LCDWIDTH + x1 + 1);
+        span.masks.assign(covered + x0, covered + x1 + 1);
+        entry->spans.push_back(std::move(span));
+    }
+}
+
+}  // namespace screen
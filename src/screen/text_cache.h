@@ -0,0 +1,59 @@
+#pragma once
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <base/macros.h>
+
+#include "oled/Edison_OLED.h"
+
+namespace screen {
+
+// LRU cache of rendered text. Text printed in NORM mode overwrites every pixel
+// of its character cells, so the result only depends on the text, font, color
+// and position and can be replayed with a masked copy into the screen buffer.
+class TextCache {
+public:
+    explicit TextCache(size_t capacity);
+
+    // Prints text at x,y with the current font of oled in color and NORM mode.
+    // With centered set, x is ignored and the text is centered on the screen.
+    void Print(edOLED& oled, const std::string& text, unsigned char x,
+               unsigned char y, unsigned char color, bool centered);
+
+    unsigned int hits() const { return hits_; }
+    unsigned int misses() const { return misses_; }
+
+private:
+    // Bytes and covered pixel masks of columns x0.. of one page
+    struct Span {
+        unsigned char page;
+        unsigned char x0;
+        std::vector<unsigned char> bytes;
+        std::vector<unsigned char> masks;
+    };
+
+    struct Entry {
+        std::string key;
+        std::vector<Span> spans;
+        // Cursor position after printing the text
+        unsigned char cursorX;
+        unsigned char cursorY;
+    };
+
+    void Render(edOLED& oled, const std::string& text, unsigned char x,
+                unsigned char y, Entry* entry);
+
+    size_t capacity_;
+    // Most recently used first
+    std::list<Entry> entries_;
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    unsigned int hits_ = 0;
+    unsigned int misses_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(TextCache);
+};
+
+}  // namespace screen